@@ -0,0 +1,115 @@
+#include "ActionMask.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+
+namespace am {
+	/// <summary>
+	/// Manhattan distance from the cell an action leads to, to a target
+	/// </summary>
+	static inline int distanceAfter(const std::pair<int, int> & state, int action, const std::pair<int, int> & target)
+	{
+		int row = state.first + ACTION_COORDS[action].first;
+		int col = state.second + ACTION_COORDS[action].second;
+		return std::abs(target.first - row) + std::abs(target.second - col);
+	}
+
+	/// <summary>
+	/// Actions that do not lead back to the previous state
+	/// </summary>
+	ActionMask noBacktrack(const std::pair<int, int> & state, const std::pair<int, int> & previousState)
+	{
+		ActionMask mask = 0;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			mask |= (ActionMask)(distanceAfter(state, a, previousState) != 0) << a;
+		}
+		return mask;
+	}
+
+	/// <summary>
+	/// Actions that strictly reduce the distance to a target
+	/// </summary>
+	ActionMask closer(const std::pair<int, int> & state, const std::pair<int, int> & target)
+	{
+		int distance = std::abs(target.first - state.first) + std::abs(target.second - state.second);
+		ActionMask mask = 0;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			mask |= (ActionMask)(distanceAfter(state, a, target) < distance) << a;
+		}
+		return mask;
+	}
+
+	/// <summary>
+	/// Actions that do not increase the distance to a target
+	/// </summary>
+	ActionMask notFurther(const std::pair<int, int> & state, const std::pair<int, int> & target)
+	{
+		int distance = std::abs(target.first - state.first) + std::abs(target.second - state.second);
+		ActionMask mask = 0;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			mask |= (ActionMask)(distanceAfter(state, a, target) <= distance) << a;
+		}
+		return mask;
+	}
+
+	/// <summary>
+	/// Actions in the mask whose value equals the largest value in the mask
+	/// </summary>
+	/// <param name="values">One value per action</param>
+	/// <param name="mask">The actions to consider</param>
+	ActionMask greedy(const float * values, ActionMask mask)
+	{
+		float best = -FLT_MAX;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			best = std::max(best, ((mask >> a) & 1) ? values[a] : -FLT_MAX);
+		}
+		ActionMask result = 0;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			result |= (ActionMask)(values[a] == best) << a;
+		}
+		return result & mask;
+	}
+
+	/// <summary>
+	/// A stage that can be switched off, a disabled stage lets every action through
+	/// </summary>
+	ActionMask enable(ActionMask filter, bool enabled)
+	{
+		return filter | (0u - (ActionMask)!enabled);
+	}
+
+	/// <summary>
+	/// Apply a filter stage to a mask, keeping the mask unchanged if the filter would remove every action
+	/// </summary>
+	ActionMask refine(ActionMask mask, ActionMask filter)
+	{
+		ActionMask filtered = mask & filter;
+		return filtered | (mask & (0u - (ActionMask)(filtered == 0)));
+	}
+
+	/// <summary>
+	/// Number of actions in a mask
+	/// </summary>
+	int count(ActionMask mask)
+	{
+		mask = mask - ((mask >> 1) & 0x55555555u);
+		mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+		return (int)((((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+	}
+
+	/// <summary>
+	/// Get the nth action in a mask counting from the lowest action index
+	/// </summary>
+	/// <param name="mask">The actions to pick from</param>
+	/// <param name="n">Which action to take, must be less than count(mask)</param>
+	int select(ActionMask mask, int n)
+	{
+		int action = 0;
+		for (int a = 0; a < NUM_ACTIONS; ++a) {
+			int bit = (mask >> a) & 1;
+			action |= -(bit & (n == 0)) & a;
+			n -= bit;
+		}
+		return action;
+	}
+}
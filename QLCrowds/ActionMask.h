@@ -0,0 +1,37 @@
+#ifndef ACTIONMASK_H
+#define ACTIONMASK_H
+
+#include <utility>
+
+/// <summary>
+/// Set of actions as a bitmask, bit a is set when action a is permitted
+/// </summary>
+typedef unsigned int ActionMask;
+
+/// <summary>
+/// Bitwise filter stages for action selection.
+/// Policies start from the environment allowed mask and refine it with stages, a refinement that would leave no
+/// action is ignored. Every stage is evaluated over all actions with comparisons folded into bits so there are no
+/// data dependent branches and nothing is allocated.
+/// </summary>
+namespace am {
+	const int NUM_ACTIONS = 5;
+	const std::pair<int, int> ACTION_COORDS[NUM_ACTIONS] = { {-1, 0}, { 0, 1}, {1, 0}, {0, -1}, {0, 0} };
+	const ActionMask ALL = (1u << NUM_ACTIONS) - 1;
+
+	// Stages
+	ActionMask noBacktrack(const std::pair<int, int> & state, const std::pair<int, int> & previousState);
+	ActionMask closer(const std::pair<int, int> & state, const std::pair<int, int> & target);
+	ActionMask notFurther(const std::pair<int, int> & state, const std::pair<int, int> & target);
+	ActionMask greedy(const float * values, ActionMask mask);
+
+	// Composition
+	ActionMask enable(ActionMask filter, bool enabled);
+	ActionMask refine(ActionMask mask, ActionMask filter);
+
+	// Selection
+	int count(ActionMask mask);
+	int select(ActionMask mask, int n);
+}
+
+#endif //!ACTIONMASK_H
@@ -0,0 +1,111 @@
+#include "ActorEnvironments.h"
+#include <cmath>
+#include <algorithm>
+
+/// <summary>
+/// Default actor environments constructor, holds no copies until created
+/// </summary>
+ActorEnvironments::ActorEnvironments() :
+	m_nextEpisode(0)
+{
+}
+
+ActorEnvironments::~ActorEnvironments()
+{
+}
+
+/// <summary>
+/// Make a copy of the environment for every actor, with empty heat maps and no agents
+/// </summary>
+/// <param name="env">The environment to copy</param>
+/// <param name="count">Number of actors</param>
+void ActorEnvironments::create(const Environment & env, int count)
+{
+	m_envs.assign(count, env);
+	for (auto & actorEnv : m_envs) {
+		actorEnv.clearHeatMap();
+		clearAgents(actorEnv);
+	}
+}
+
+void ActorEnvironments::clear()
+{
+	m_envs.clear();
+}
+
+/// <summary>
+/// Get an actor's copy, references stay valid until the copies are created again or cleared
+/// </summary>
+Environment & ActorEnvironments::at(int index)
+{
+	return m_envs[index];
+}
+
+int ActorEnvironments::size() const
+{
+	return (int)m_envs.size();
+}
+
+/// <summary>
+/// Reset the episode counter, the first episode claimed explores with epsilon and each later one decays it
+/// </summary>
+/// <param name="numEpisodes">Episodes to run across all actors</param>
+/// <param name="epsilon">Exploration rate of the first episode</param>
+/// <param name="epsilonDecay">Exploration decay per episode</param>
+/// <param name="minEpsilon">The lowest the exploration rate decays to</param>
+void ActorEnvironments::startEpisodes(int numEpisodes, float epsilon, float epsilonDecay, float minEpsilon)
+{
+	m_numEpisodes = numEpisodes;
+	m_epsilon = epsilon;
+	m_epsilonDecay = epsilonDecay;
+	m_minEpsilon = minEpsilon;
+	m_nextEpisode = 0;
+}
+
+/// <summary>
+/// Claim the next episode, safe to call from any actor
+/// </summary>
+/// <param name="epsilon">Receives the exploration rate of the claimed episode</param>
+/// <returns>False once every episode has been claimed</returns>
+bool ActorEnvironments::claimEpisode(float & epsilon)
+{
+	int episode = m_nextEpisode.fetch_add(1);
+	if (episode >= m_numEpisodes)
+		return false;
+	epsilon = std::max(m_minEpsilon, m_epsilon * std::pow(m_epsilonDecay, (float)episode));
+	return true;
+}
+
+/// <summary>
+/// Episodes claimed so far
+/// </summary>
+int ActorEnvironments::getEpisodes() const
+{
+	return std::min(m_numEpisodes, m_nextEpisode.load());
+}
+
+/// <summary>
+/// Add what the actors visited to an environment's heat map so it shows the whole run
+/// </summary>
+void ActorEnvironments::mergeHeatMaps(Environment & env) const
+{
+	for (auto & actorEnv : m_envs) {
+		for (int row = 0; row < (int)env.m_heatMap.size(); ++row) {
+			for (int col = 0; col < (int)env.m_heatMap[row].size(); ++col) {
+				env.m_heatMap[row][col] += actorEnv.m_heatMap[row][col];
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Clear every tile's agent flag
+/// </summary>
+void ActorEnvironments::clearAgents(Environment & env)
+{
+	for (auto & row : env.m_tileFlags) {
+		for (auto & flags : row) {
+			flags &= ~QLCContainsAgent;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef ACTORENVIRONMENTS_H
+#define ACTORENVIRONMENTS_H
+
+#include <vector>
+#include <atomic>
+
+#include "Environment.h"
+
+/// <summary>
+/// What the actor threads of ActorLearner and AsyncDQNTrainer share: one copy of the environment per actor and
+/// the episode schedule. Each actor is alone in its copy, so the copies have no tile marked as holding an agent.
+/// Episodes are claimed from one counter so the exploration schedule follows the total number of episodes run,
+/// not the number of actors. Once the actors are done their heat maps are merged back into the original.
+/// </summary>
+class ActorEnvironments {
+public:
+	ActorEnvironments();
+	~ActorEnvironments();
+
+	void create(const Environment & env, int count);
+	void clear();
+	Environment & at(int index);
+	int size() const;
+
+	void startEpisodes(int numEpisodes, float epsilon, float epsilonDecay, float minEpsilon);
+	bool claimEpisode(float & epsilon);
+	int getEpisodes() const;
+
+	void mergeHeatMaps(Environment & env) const;
+
+	static void clearAgents(Environment & env);
+private:
+	ActorEnvironments(const ActorEnvironments &);
+	ActorEnvironments & operator=(const ActorEnvironments &);
+
+	std::vector<Environment> m_envs;
+	std::atomic<int> m_nextEpisode;
+	int m_numEpisodes = 0;
+	float m_epsilon = 1.f;
+	float m_epsilonDecay = 1.f;
+	float m_minEpsilon = 0.f;
+};
+
+#endif //!ACTORENVIRONMENTS_H
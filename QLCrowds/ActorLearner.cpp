@@ -0,0 +1,235 @@
+#include "ActorLearner.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+/// <summary>
+/// Default actor learner constructor
+/// </summary>
+ActorLearner::ActorLearner() :
+	m_front(0),
+	m_activeActors(0)
+{
+	m_readers[0] = 0;
+	m_readers[1] = 0;
+}
+
+ActorLearner::~ActorLearner()
+{
+}
+
+/// <summary>
+/// Train the learner from the actors until they have run the episodes between them, see ActorEnvironments
+/// for how episodes are shared out. The heat maps of the actors' environments are merged back into env.
+/// </summary>
+/// <param name="learner">The agent whose table is trained, only ever touched by the calling thread</param>
+/// <param name="env">The environment every actor takes a copy of</param>
+/// <param name="numEpisodes">Episodes to run across all actors</param>
+/// <param name="maxIterations">Step limit of an episode</param>
+/// <param name="epsilon">Exploration rate of the first episode</param>
+/// <param name="epsilonDecay">Exploration decay per episode</param>
+/// <returns>Update counts and throughput of the run</returns>
+ActorLearner::Stats ActorLearner::run(Agent & learner, Environment & env, int numEpisodes, int maxIterations, float epsilon, float epsilonDecay)
+{
+	int numActors = std::max(1, m_numActors);
+	auto start = std::chrono::steady_clock::now();
+
+	m_queues.clear();
+	for (int i = 0; i < numActors; ++i) {
+		m_queues.emplace_back(new SPSCQueue<Target>(m_queueCapacity));
+	}
+	m_envs.create(env, numActors);
+	m_envs.startEpisodes(numEpisodes, epsilon, epsilonDecay, m_minEpsilon);
+
+	// Both snapshots start as a full copy, after that only changed states are copied
+	const QTable & Q = learner.Q;
+	int states = Q.getRows() * Q.getCols();
+	m_cols = Q.getCols();
+	m_actions = Q.getActions();
+	for (int b = 0; b < 2; ++b) {
+		m_snapshots[b].resize((size_t)states * m_actions);
+		for (int s = 0; s < states; ++s) {
+			for (int a = 0; a < m_actions; ++a) {
+				m_snapshots[b][s * m_actions + a] = Q.get(s / m_cols, s % m_cols, a);
+			}
+		}
+		m_changed[b].assign(states, 0);
+		m_changedStates[b].clear();
+		m_readers[b] = 0;
+	}
+	m_front = 0;
+	m_activeActors = numActors;
+
+	std::vector<std::thread> actors;
+	for (int i = 0; i < numActors; ++i) {
+		actors.push_back(std::thread(&ActorLearner::actor, this, i, maxIterations, learner.m_gamma, learner.m_backTracking));
+	}
+
+	// Drain the queues in turns so no actor is starved, finishing once every actor has stopped and nothing is left
+	Stats stats;
+	long long sincePublish = 0;
+	const int batch = 64;
+	while (true) {
+		bool finished = m_activeActors.load(std::memory_order_acquire) == 0;
+		int drained = 0;
+		for (auto & queue : m_queues) {
+			Target t;
+			for (int n = 0; n < batch && queue->tryPop(t); ++n) {
+				learner.trainTarget(t.state, t.action, t.target);
+				markChanged(t.state.first * m_cols + t.state.second);
+				drained++;
+			}
+		}
+		stats.updates += drained;
+		sincePublish += drained;
+		// A publish waits for a later drain while actors still read the back snapshot
+		if (sincePublish >= m_publishInterval && publish(Q))
+			sincePublish = 0;
+		if (drained == 0) {
+			if (finished)
+				break;
+			std::this_thread::yield();
+		}
+	}
+	for (auto & thread : actors) {
+		thread.join();
+	}
+
+	m_envs.mergeHeatMaps(env);
+	m_envs.clear();
+	m_queues.clear();
+	for (int b = 0; b < 2; ++b) {
+		std::vector<float>().swap(m_snapshots[b]);
+		std::vector<unsigned char>().swap(m_changed[b]);
+		std::vector<int>().swap(m_changedStates[b]);
+	}
+
+	stats.episodes = m_envs.getEpisodes();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.updatesPerSecond = stats.seconds > 0 ? stats.updates / stats.seconds : 0;
+	return stats;
+}
+
+/// <summary>
+/// Actor thread, runs episodes in its own environment copy with the latest published policy and computes the
+/// TD target of every step from it
+/// </summary>
+void ActorLearner::actor(int id, int maxIterations, float gamma, bool backTracking)
+{
+	Environment & env = m_envs.at(id);
+	SPSCQueue<Target> & queue = *m_queues[id];
+	std::mt19937 generator(std::random_device{}() + id);
+	auto spawns = env.getSpawnablePoint();
+
+	float episodeEpsilon;
+	while (!spawns.empty() && m_envs.claimEpisode(episodeEpsilon)) {
+		std::uniform_int_distribution<int> spawn(0, (int)spawns.size() - 1);
+		State currentState = spawns[spawn(generator)];
+		State previousState = currentState;
+
+		int snapshot = acquireSnapshot();
+		const float * Q = m_snapshots[snapshot].data();
+		for (int iter = 0; iter < maxIterations; ++iter) {
+			// The snapshot is only retaken every few steps so an actor does not contend on it every step
+			if (iter > 0 && iter % m_refreshInterval == 0) {
+				m_readers[snapshot].fetch_sub(1);
+				snapshot = acquireSnapshot();
+				Q = m_snapshots[snapshot].data();
+			}
+			int action = selectAction(Q, env, currentState, previousState, episodeEpsilon, backTracking, generator);
+			auto stateVals = env.step(action, currentState);
+			State nextState = std::get<0>(stateVals);
+			bool done = std::get<2>(stateVals);
+			Target t;
+			t.state = currentState;
+			t.action = action;
+			t.target = std::get<1>(stateVals);
+			if (!done) {
+				const float * next = row(Q, nextState);
+				t.target += gamma * *std::max_element(next, next + m_actions);
+			}
+			while (!queue.tryPush(t)) {
+				std::this_thread::yield();
+			}
+			previousState = currentState;
+			currentState = nextState;
+			if (done)
+				break;
+		}
+		m_readers[snapshot].fetch_sub(1);
+	}
+	m_activeActors.fetch_sub(1, std::memory_order_release);
+}
+
+/// <summary>
+/// Epsilon greedy selection over the allowed actions, the same policy as Agent::getAction but on a snapshot
+/// </summary>
+int ActorLearner::selectAction(const float * Q, const Environment & env, const State & currentState, const State & previousState, float epsilon, bool backTracking, std::mt19937 & generator) const
+{
+	ActionMask mask = env.allowedActionMask(currentState);
+	mask = am::refine(mask, am::enable(am::noBacktrack(currentState, previousState), backTracking));
+
+	std::uniform_real_distribution<float> distr(0, 1);
+	if (distr(generator) >= epsilon)
+		mask = am::greedy(row(Q, currentState), mask);
+	std::uniform_int_distribution<int> pick(0, am::count(mask) - 1);
+	return am::select(mask, pick(generator));
+}
+
+/// <summary>
+/// The action values of a state in a snapshot
+/// </summary>
+const float * ActorLearner::row(const float * Q, const State & state) const
+{
+	return Q + (size_t)(state.first * m_cols + state.second) * m_actions;
+}
+
+/// <summary>
+/// Take the front snapshot for an episode, the caller releases it by decrementing its reader count.
+/// The front is checked again once counted as a reader so the learner cannot have started writing it.
+/// </summary>
+/// <returns>Index of the snapshot</returns>
+int ActorLearner::acquireSnapshot()
+{
+	while (true) {
+		int snapshot = m_front.load();
+		m_readers[snapshot].fetch_add(1);
+		if (m_front.load() == snapshot)
+			return snapshot;
+		m_readers[snapshot].fetch_sub(1);
+	}
+}
+
+/// <summary>
+/// Record that a state's values changed, for both snapshots as each is written every other publish
+/// </summary>
+void ActorLearner::markChanged(int state)
+{
+	for (int b = 0; b < 2; ++b) {
+		if (!m_changed[b][state]) {
+			m_changed[b][state] = 1;
+			m_changedStates[b].push_back(state);
+		}
+	}
+}
+
+/// <summary>
+/// Copy the states changed since the back snapshot was last written into it and make it the front
+/// </summary>
+/// <returns>False if an actor is still reading the back snapshot, nothing is written then</returns>
+bool ActorLearner::publish(const QTable & Q)
+{
+	int back = 1 - m_front.load();
+	if (m_readers[back].load() > 0)
+		return false;
+	float * values = m_snapshots[back].data();
+	for (int state : m_changedStates[back]) {
+		for (int a = 0; a < m_actions; ++a) {
+			values[state * m_actions + a] = Q.get(state / m_cols, state % m_cols, a);
+		}
+		m_changed[back][state] = 0;
+	}
+	m_changedStates[back].clear();
+	m_front.store(back);
+	return true;
+}
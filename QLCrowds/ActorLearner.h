@@ -0,0 +1,70 @@
+#ifndef ACTORLEARNER_H
+#define ACTORLEARNER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "Agent.h"
+#include "SPSCQueue.h"
+#include "ActorEnvironments.h"
+
+/// <summary>
+/// Trains one tabular Q learning agent from many concurrent actors.
+/// Every actor steps its own copy of the environment on its own thread and acts on a read only snapshot of
+/// the learner's table. The actor also computes each transition's TD target r + gamma * max Q(s') from that
+/// snapshot, so only the state, action and target go through its lock free queue. The calling thread is the
+/// single learner, draining the queues in batches and moving each Q(s, a) towards its target, a read and a
+/// write per update. Bootstrapping from a snapshot a few hundred updates old works like a DQN target network.
+/// Snapshots are double buffered fp32 copies of the table. A publish only copies the states updated since
+/// that buffer was last written, into the buffer no actor is reading, then flips which one actors take.
+/// Planning backups are not run, the actors give the learner more real experience instead.
+/// </summary>
+class ActorLearner {
+public:
+	struct Target {
+		State state;
+		int action;
+		float target;
+	};
+
+	struct Stats {
+		long long updates = 0;
+		int episodes = 0;
+		double seconds = 0;
+		double updatesPerSecond = 0;
+	};
+
+	ActorLearner();
+	~ActorLearner();
+
+	int m_numActors = 4;
+	int m_queueCapacity = 64;			// Targets each actor can have in flight before it waits on the learner, short so actors stay on a recent policy
+	int m_publishInterval = 100;		// Learner updates between policy snapshots
+	int m_refreshInterval = 16;		// Actor steps between taking the latest snapshot
+	float m_minEpsilon = 0.01f;
+
+	Stats run(Agent & learner, Environment & env, int numEpisodes, int maxIterations, float epsilon, float epsilonDecay);
+private:
+	// Two snapshots of the table, actors take the front one for an episode and the learner writes the other
+	std::vector<float> m_snapshots[2];
+	std::atomic<int> m_front;
+	std::atomic<int> m_readers[2];
+	std::vector<unsigned char> m_changed[2];	// Per state, updated since the snapshot was last written
+	std::vector<int> m_changedStates[2];
+	int m_cols = 0;
+	int m_actions = 0;
+
+	std::vector<std::unique_ptr<SPSCQueue<Target>>> m_queues;
+	ActorEnvironments m_envs;
+	std::atomic<int> m_activeActors;
+
+	void actor(int id, int maxIterations, float gamma, bool backTracking);
+	int selectAction(const float * Q, const Environment & env, const State & currentState, const State & previousState, float epsilon, bool backTracking, std::mt19937 & generator) const;
+	const float * row(const float * Q, const State & state) const;
+	int acquireSnapshot();
+	void markChanged(int state);
+	bool publish(const QTable & Q);
+};
+
+#endif //!ACTORLEARNER_H
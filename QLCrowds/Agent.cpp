@@ -4,105 +4,149 @@
 
 #include <algorithm>
 #include <iterator>
+#include <climits>
 #include <math.h>
 
-Agent::Agent(Environment &env, SDL_Renderer * renderer) :
-	m_env(env)
+/// <summary>
+/// Construct an agent for the given environment
+/// </summary>
+/// <param name="env">The environment the agent acts in</param>
+/// <param name="sharedTable">A Q table shared by many agents, the owner is responsible for sizing and clearing it</param>
+Agent::Agent(Environment &env, std::shared_ptr<QTable> sharedTable) :
+	m_table(sharedTable ? sharedTable : std::make_shared<QTable>()),
+	Q(*m_table),
+	m_env(env),
+	m_sharedTable(sharedTable != nullptr),
+	m_generator(std::random_device()())
 {
 	m_stateDim = std::make_pair(env.ySize, env.xSize);
 	m_actionDim = env.getActionDim();
-	Q.resize(m_stateDim.first);
-	for (int row = 0; row < m_stateDim.first; ++row) {
-		Q.at(row).resize(m_stateDim.second);
-		for (int col = 0; col < m_stateDim.second; ++col) {
-			Q.at(row).at(col).resize(m_actionDim.first);
-			for (int action = 0; action < m_actionDim.first; ++action) {
-				Q[row][col][action] = 0;
-			}
-		}
-	}
-			
-	m_sprite.loadTexture("Assets/agent.png", renderer);
-	m_sprite.setBounds(env.cellW, env.cellH);
+	if (!m_sharedTable)
+		Q.resize(m_stateDim.first, m_stateDim.second, m_actionDim.first);
+	m_planner.resize(m_stateDim.first, m_stateDim.second, m_actionDim.first);
+	m_convergence.resize(m_stateDim.first, m_stateDim.second);
 	m_backTracking = true;
+	m_memory.setCapacity(maxMemorySize);
+	m_memory.seed(m_generator());
 }
 
 Agent::~Agent()
 {
 }
 
-int Agent::getAction(Environment & env)
+/// <summary>
+/// Get an epsilon greedy action from the Q table, random actions are drawn with probability epsilon
+/// </summary>
+/// <param name="env">The environment to get the allowed actions from</param>
+/// <param name="currentState">The state the agent is in</param>
+/// <param name="previousState">The state the agent was in last step, used to prevent backtracking</param>
+/// <param name="epsilon">The exploration probability</param>
+/// <param name="random">Generator of the acting agent's draws</param>
+/// <param name="isGreedy">Set to whether the action is greedy, which an exploratory draw can still be</param>
+/// <returns>The index of the action for the agent to take</returns>
+int Agent::getAction(Environment & env, const State & currentState, const State & previousState, float epsilon, std::minstd_rand & random, bool * isGreedy)
 {
-	std::random_device rand_dev;
-	std::mt19937 generator(rand_dev());
+	ActionMask mask = env.allowedActionMask(currentState);
+	mask = am::refine(mask, am::enable(am::noBacktrack(currentState, previousState), m_backTracking));
+
+	float values[am::NUM_ACTIONS];
+	for (int a = 0; a < am::NUM_ACTIONS; ++a) {
+		values[a] = Q.get(currentState.first, currentState.second, a);
+	}
+	ActionMask greedy = am::greedy(values, mask);
+
 	std::uniform_real_distribution<double> distr(0, 1);
-	double randVal = distr(generator);
-	if (randVal < m_epsilon) {
-		auto actions_allowed = env.allowedActions(m_currentState);
-		if (m_backTracking) {
-			if (actions_allowed.size() > 1) {
-				bool actionRemoved = false;
-				int actionToRemove;
-				for (auto & action : actions_allowed) {
-					std::pair<int, int> actionDir = env.actionCoords[action];
-					std::pair<int, int> nextState(m_currentState.first + actionDir.first, m_currentState.second + actionDir.second);
-					if (nextState.first == m_previousState.first && nextState.second == m_previousState.second) {
-						actionToRemove = action;
-						actionRemoved = true;
-						break;
-					}
-				}
-				if (actionRemoved) {
-					actions_allowed.erase(std::remove(actions_allowed.begin(), actions_allowed.end(), actionToRemove), actions_allowed.end());
-				}
-			}
-		}
-		std::uniform_int_distribution<int>  distr(0, actions_allowed.size() - 1);
-		int index = distr(generator);
-		return actions_allowed.at(index);
+	if (distr(random) < epsilon) {
+		int action = randomAction(mask, random);
+		// Watkins Q(lambda) needs to know if the exploratory action happened to be greedy
+		if (isGreedy)
+			*isGreedy = (greedy >> action) & 1;
+		return action;
+	}
+	if (isGreedy)
+		*isGreedy = true;
+	return randomAction(greedy, random);
+}
+
+/// <summary>
+/// Get an epsilon greedy action from the values the DQN predicts for the state, random actions are drawn with probability epsilon
+/// </summary>
+/// <param name="env">The environment to get the allowed actions from</param>
+/// <param name="currentState">The state the agent is in</param>
+/// <param name="previousState">The state the agent was in last step, used to prevent backtracking</param>
+/// <param name="epsilon">The exploration probability</param>
+/// <returns>The index of the action for the agent to take</returns>
+int Agent::getActionDQN(Environment & env, const State & currentState, const State & previousState, float epsilon)
+{
+	if (explores(epsilon, m_generator))
+		return getActionDQN(env, currentState, previousState, nullptr, m_generator);
+
+	m_encoder.update(m_env);
+	m_encoded.resize(m_encoder.size());
+	m_encoder.encode(currentState, m_encoded.data());
+	float values[am::NUM_ACTIONS];
+	if (m_kernel.ready()) {
+		m_kernel.forward(m_encoded.data(), values);
 	}
 	else {
-		auto actions_allowed = env.allowedActions(m_currentState);
-		if (m_backTracking) {
-			// Strip away backtracking actions
-			if (actions_allowed.size() > 1) {
-				bool actionRemoved = false;
-				int actionToRemove;
-				for (auto & action : actions_allowed) {
-					std::pair<int, int> actionDir = env.actionCoords[action];
-					std::pair<int, int> nextState(m_currentState.first + actionDir.first, m_currentState.second + actionDir.second);
-					if (nextState.first == m_previousState.first && nextState.second == m_previousState.second) {
-						actionToRemove = action;
-						actionRemoved = true;
-						break;
-					}
-				}
-				if (actionRemoved) {
-					actions_allowed.erase(std::remove(actions_allowed.begin(), actions_allowed.end(), actionToRemove), actions_allowed.end());
-				}
-			}
-		}
-		auto actionValues = Q[m_currentState.first][m_currentState.second];
+		tiny_dnn::vec_t predicted = m_model.predict(m_encoded);
+		std::copy(predicted.begin(), predicted.begin() + am::NUM_ACTIONS, values);
+	}
+	return getActionDQN(env, currentState, previousState, values, m_generator);
+}
 
-		std::map<int, float> qs;
-		for (int action : actions_allowed) {
-			qs[action] = actionValues.at(action);
-		}
-		float maxVal = qs.begin()->second;
-		for (auto & actionMapping : qs) {
-			if (actionMapping.second > maxVal) {
-				maxVal = actionMapping.second;
-			}
-		}
-		std::vector<int> actions_greedy;
-		for (auto & actionMapping : qs) {
-			if (actionMapping.second == maxVal) {
-				actions_greedy.push_back(actionMapping.first);
-			}
+/// <summary>
+/// Chose an action from values already predicted for the current state, or at random among the allowed actions when
+/// values is null. Lets the network's forward pass run elsewhere, batched with other agents
+/// </summary>
+int Agent::getActionDQN(Environment & env, const State & currentState, const State & previousState, const float * values, std::minstd_rand & random)
+{
+	ActionMask mask = env.allowedActionMask(currentState);
+	mask = am::refine(mask, am::enable(am::noBacktrack(currentState, previousState), m_backTracking));
+	if (!values)
+		return randomAction(mask, random);
+	return randomAction(am::greedy(values, mask), random);
+}
+
+/// <summary>
+/// Draw whether the next action explores at random, one draw per action as getActionDQN makes
+/// </summary>
+bool Agent::explores(float epsilon, std::minstd_rand & random)
+{
+	std::uniform_real_distribution<double> distr(0, 1);
+	return distr(random) < epsilon;
+}
+
+/// <summary>
+/// Predict the action values of several states in one forward pass of the online network
+/// </summary>
+/// <param name="states">States to evaluate</param>
+/// <param name="values">Receives am::NUM_ACTIONS values per state, in the order of states</param>
+void Agent::predictBatch(const std::vector<State> & states, std::vector<float> & values)
+{
+	int count = (int)states.size();
+	values.resize(count * am::NUM_ACTIONS);
+	if (count == 0)
+		return;
+	m_encoder.update(m_env);
+	int inputSize = m_encoder.size();
+	if (m_kernel.ready()) {
+		m_inferenceInputs.resize(count * inputSize);
+		for (int i = 0; i < count; ++i) {
+			m_encoder.encode(states[i], &m_inferenceInputs[i * inputSize]);
 		}
-		std::uniform_int_distribution<int>  distr(0, actions_greedy.size() - 1);
-		int index = distr(generator);
-		return actions_greedy.at(index);
+		m_kernel.forwardBatch(m_inferenceInputs.data(), count, values.data());
+		return;
+	}
+	if (!m_inferenceBatch.empty() && (int)m_inferenceBatch[0][0].size() != inputSize)
+		m_inferenceBatch.clear();
+	m_inferenceBatch.resize(count, tiny_dnn::tensor_t(1, tiny_dnn::vec_t(inputSize)));
+	for (int i = 0; i < count; ++i) {
+		m_encoder.encode(states[i], m_inferenceBatch[i][0].data());
+	}
+	std::vector<tiny_dnn::tensor_t> predicted = m_model.predict(m_inferenceBatch);
+	for (int i = 0; i < count; ++i) {
+		std::copy(predicted[i][0].begin(), predicted[i][0].begin() + am::NUM_ACTIONS, &values[i * am::NUM_ACTIONS]);
 	}
 }
 
@@ -128,11 +172,100 @@ void Agent::train(std::tuple<std::pair<int, int>, int, std::pair<int, int>, floa
 	auto reward = std::get<3>(t);
 	bool done = std::get<4>(t);
 
-	float & sa = Q[state.first][state.second][action];
-	auto nextActions = Q[state_next.first][state_next.second];
+	// Read and accumulate in fp32 whatever the table storage precision is
+	float sa = Q.get(state.first, state.second, action);
+	float maxElement = Q.maxValue(state_next.first, state_next.second);
+	float delta = reward + m_gamma * maxElement - sa;
+	Q.set(state.first, state.second, action, sa + m_beta * delta);
+	m_convergence.observe(state.first, state.second, Q.greedyAction(state.first, state.second), delta);
+	plan(t);
+}
+
+/// <summary>
+/// Move one Q value towards a TD target computed elsewhere, as the actors of an ActorLearner do.
+/// Planning needs the whole transition so it is not run.
+/// </summary>
+/// <param name="state">The state the action was taken from</param>
+/// <param name="action">The action taken</param>
+/// <param name="target">The reward plus the discounted value of the next state</param>
+void Agent::trainTarget(const State & state, int action, float target)
+{
+	float sa = Q.get(state.first, state.second, action);
+	float delta = target - sa;
+	Q.set(state.first, state.second, action, sa + m_beta * delta);
+	m_convergence.observe(state.first, state.second, Q.greedyAction(state.first, state.second), delta);
+}
+
+/// <summary>
+/// Train the agent using eligibility traces, Watkins Q(lambda) when no next action is given and SARSA(lambda) otherwise.
+/// Traces are kept in a sparse list of active state action pairs so the cost of an update is proportional to the
+/// number of recently visited pairs rather than the size of the Q table. Traces that decay below the cutoff are dropped.
+/// For Watkins Q(lambda) the caller must clear the traces when an exploratory (non greedy) action is taken.
+/// The traces belong to the acting agent, agents sharing a learner each keep their own.
+/// </summary>
+/// <param name="t">The transition as state, action, next state, reward and done</param>
+/// <param name="traces">The acting agent's active traces, cleared when the episode ends</param>
+/// <param name="nextAction">The on policy action taken from the next state or -1 to back up the greedy value</param>
+void Agent::trainLambda(std::tuple<std::pair<int, int>, int, std::pair<int, int>, float, bool> t, std::vector<EligibilityTrace> & traces, int nextAction)
+{
+	auto state = std::get<0>(t);
+	int action = std::get<1>(t);
+	auto state_next = std::get<2>(t);
+	auto reward = std::get<3>(t);
+	bool done = std::get<4>(t);
+
+	float nextValue = 0;
+	if (!done) {
+		if (nextAction >= 0)
+			nextValue = Q.get(state_next.first, state_next.second, nextAction);
+		else
+			nextValue = Q.maxValue(state_next.first, state_next.second);
+	}
+	float delta = reward + m_gamma * nextValue - Q.get(state.first, state.second, action);
+
+	// Replacing traces, revisiting a pair resets its trace rather than accumulating it
+	auto pred = [&state, action](const EligibilityTrace & trace) {
+		return trace.action == action && trace.state == state;
+	};
+	auto existing = std::find_if(traces.begin(), traces.end(), pred);
+	if (existing != traces.end()) {
+		existing->value = 1.f;
+	}
+	else {
+		traces.push_back({ state, action, 1.f });
+	}
+
+	float traceDecay = m_gamma * m_lambda;
+	for (size_t i = 0; i < traces.size();) {
+		auto & trace = traces[i];
+		Q.add(trace.state.first, trace.state.second, trace.action, m_beta * delta * trace.value);
+		m_convergence.observe(trace.state.first, trace.state.second, Q.greedyAction(trace.state.first, trace.state.second), delta * trace.value);
+		trace.value *= traceDecay;
+		if (trace.value < m_traceCutoff) {
+			// Swap with the back so removal is constant time
+			trace = traces.back();
+			traces.pop_back();
+		}
+		else {
+			++i;
+		}
+	}
+	if (done) {
+		traces.clear();
+	}
+	plan(t);
+}
 
-	auto maxElement = *std::max_element(nextActions.begin(), nextActions.end());
-	Q[state.first][state.second][action] += m_beta * (reward + m_gamma * maxElement - sa);
+/// <summary>
+/// Record a real transition in the planner model and run the planning backups for this step if planning is enabled
+/// </summary>
+/// <param name="t">The transition as state, action, next state, reward and done</param>
+void Agent::plan(const std::tuple<std::pair<int, int>, int, std::pair<int, int>, float, bool> & t)
+{
+	if (m_planning) {
+		m_planner.observe(Q, std::get<0>(t), std::get<1>(t), std::get<2>(t), std::get<3>(t), std::get<4>(t), m_gamma);
+		m_planner.plan(Q, m_planningSteps, m_beta, m_gamma);
+	}
 }
 
 /// <summary>
@@ -142,58 +275,23 @@ void Agent::train(std::tuple<std::pair<int, int>, int, std::pair<int, int>, floa
 /// - if backtracking is disabled prevent taking your previous action if only 1 action is available take that action even if it backtracks
 /// </summary>
 /// <param name="env">The enviornment for the agent to choose an action from</param>
+/// <param name="currentState">The state the agent is in</param>
 /// <returns>The index of the action for the agent to take</returns>
-int Agent::getActionRBMBased(Environment & env)
+int Agent::getActionRBMBased(Environment & env, const State & currentState)
 {
-	auto allowedActions = env.allowedActions(m_currentState);
 	auto & goals = env.getGoals();
-	std::pair<int, int> cellsfromGoal;
-	std::pair<int, int> closestGoal = goals.at(0);
-	cellsfromGoal.first = abs(goals.at(0).first - m_currentState.first);
-	cellsfromGoal.second = abs(goals.at(0).second - m_currentState.second);
-	int combinedCellDist = cellsfromGoal.first + cellsfromGoal.second;
-	for (std::pair<int, int> & goal : goals) {
-		int goalcellDist = abs(goal.first - m_currentState.first) + abs(goal.second - m_currentState.second);
-		if (goalcellDist < combinedCellDist) {
-			combinedCellDist = goalcellDist;
-			cellsfromGoal = std::make_pair(abs(goal.first - m_currentState.first), abs(goal.second - m_currentState.second));
-			closestGoal = goal;
-		}
-	}
-	std::vector<std::pair<int, int>> closestGoals;
+	int combinedCellDist = INT_MAX;
 	for (auto & goal : goals) {
-		if (abs(goal.first - m_currentState.first) + abs(goal.second - m_currentState.second) == combinedCellDist) {
-			closestGoals.push_back(goal);
-		}
-	}
-	std::vector<int> actionsToRemove;
-	for (auto & action : allowedActions) {
-		std::pair<int, int> nextState;
-		auto actionDir = env.actionCoords[action];
-		nextState.first = actionDir.first + m_currentState.first;
-		nextState.second = actionDir.second + m_currentState.second;
-		bool progresses = false;
-		for (auto & goal : closestGoals) {
-			if (abs(goal.first - nextState.first) + abs(goal.second - nextState.second) < combinedCellDist)
-				progresses = true;
-		}
-		if (!progresses) {
-			actionsToRemove.push_back(action);
-		}
+		combinedCellDist = std::min(combinedCellDist, abs(goal.first - currentState.first) + abs(goal.second - currentState.second));
 	}
-	if (actionsToRemove.size() != allowedActions.size()) {
-		for (auto & action : actionsToRemove) {
-			allowedActions.erase(std::remove(allowedActions.begin(), allowedActions.end(), action), allowedActions.end());
-		}
+	// Progress towards any of the equally closest goals
+	ActionMask progress = 0;
+	for (auto & goal : goals) {
+		ActionMask isClosest = 0u - (ActionMask)(abs(goal.first - currentState.first) + abs(goal.second - currentState.second) == combinedCellDist);
+		progress |= am::closer(currentState, goal) & isClosest;
 	}
-
-	std::random_device rand_dev;
-	std::mt19937 generator(rand_dev());
-
-	std::uniform_int_distribution<int>  distr;
-	distr = std::uniform_int_distribution<int>(0, allowedActions.size() - 1);
-	int index = distr(generator);
-	return allowedActions.at(index);
+	ActionMask mask = am::refine(env.allowedActionMask(currentState), progress);
+	return randomAction(mask);
 }
 
 /// <summary>
@@ -208,108 +306,46 @@ int Agent::getActionRBMBased(Environment & env)
 ///			- Take an action that moves you one step closer to the goal
 /// </summary>
 /// <param name="env">Environment to get the available actions from</param>
+/// <param name="currentState">The state the agent is in</param>
+/// <param name="previousState">The state the agent was in last step, used to prevent backtracking</param>
 /// <param name="currentIter"> The current iteration the agent is on to know if it is possible to make it to the goal</param>
 /// <param name="maxIters">The maximum number of iterations for the calculation of the agents ability to reach the goal</param>
 /// <returns>An integer representing the action to be taken</returns>
-int Agent::getMultiAgentActionRBM(Environment & env, int currentIter, const int maxIters)
+int Agent::getMultiAgentActionRBM(Environment & env, const State & currentState, const State & previousState, int currentIter, const int maxIters)
 {
-	auto allowedActions = env.allowedActions(m_currentState);
 	auto & goals = env.getGoals();
-
-	std::pair<int, int> cellsfromGoal;
 	std::pair<int, int> closestGoal = goals.at(0);
-	cellsfromGoal.first = abs(goals.at(0).first - m_currentState.first);
-	cellsfromGoal.second = abs(goals.at(0).second - m_currentState.second);
-	int combinedCellDist = cellsfromGoal.first + cellsfromGoal.second;
+	int combinedCellDist = abs(closestGoal.first - currentState.first) + abs(closestGoal.second - currentState.second);
 	for (std::pair<int, int> & goal : goals) {
-		int goalcellDist = abs(goal.first - m_currentState.first) + abs(goal.second - m_currentState.second);
+		int goalcellDist = abs(goal.first - currentState.first) + abs(goal.second - currentState.second);
 		if (goalcellDist < combinedCellDist) {
 			combinedCellDist = goalcellDist;
-			cellsfromGoal = std::make_pair(abs(goal.first - m_currentState.first), abs(goal.second - m_currentState.second));
 			closestGoal = goal;
 		}
 	}
 
+	ActionMask mask = env.allowedActionMask(currentState);
+	mask = am::refine(mask, am::enable(am::noBacktrack(currentState, previousState), m_backTracking));
 	// If you must go to goal
-	if (combinedCellDist >= maxIters - 1 - currentIter) {
-	std::vector<int> actionsToRemove;
-	if (m_backTracking) {
-		if (allowedActions.size() > 1) {
-			bool actionRemoved = false;
-			int actionToRemove;
-			for (auto & action : allowedActions) {
-				std::pair<int, int> actionDir = env.actionCoords[action];
-				std::pair<int, int> nextState(m_currentState.first + actionDir.first, m_currentState.second + actionDir.second);
-				if (nextState.first == m_previousState.first && nextState.second == m_previousState.second) {
-					actionToRemove = action;
-					actionRemoved = true;
-					break;
-				}
-			}
-			if (actionRemoved) {
-				allowedActions.erase(std::remove(allowedActions.begin(), allowedActions.end(), actionToRemove), allowedActions.end());
-			}
-		}
-	}
-	for (auto & action : allowedActions) {
-		std::pair<int, int> nextState;
-		auto actionDir = env.actionCoords[action];
-		nextState.first = actionDir.first + m_currentState.first;
-		nextState.second = actionDir.second + m_currentState.second;
-		if (abs(closestGoal.first - nextState.first) + abs(closestGoal.second - nextState.second) >= combinedCellDist) {
-			actionsToRemove.push_back(action);
-		}
-	}
-	if (actionsToRemove.size() != allowedActions.size()) {
-		for (auto & action : actionsToRemove) {
-			allowedActions.erase(std::remove(allowedActions.begin(), allowedActions.end(), action), allowedActions.end());
-		}
-	}
-	}
-	else { // If you can group
-		std::pair<int, int> closestAgentState = env.getClosestAgent(m_currentState);
-		int agentDist = abs(closestAgentState.first - m_currentState.first) + abs(closestAgentState.second - m_currentState.second);
-		std::vector<int> actionsToRemove;
-		if (m_backTracking) {
-			if (allowedActions.size() > 1) {
-				bool actionRemoved = false;
-				int actionToRemove;
-				for (auto & action : allowedActions) {
-					std::pair<int, int> actionDir = env.actionCoords[action];
-					std::pair<int, int> nextState(m_currentState.first + actionDir.first, m_currentState.second + actionDir.second);
-					if (nextState.first == m_previousState.first && nextState.second == m_previousState.second) {
-						actionToRemove = action;
-						actionRemoved = true;
-						break;
-					}
-				}
-				if (actionRemoved) {
-					allowedActions.erase(std::remove(allowedActions.begin(), allowedActions.end(), actionToRemove), allowedActions.end());
-				}
-			}
-		}
-		for (auto & action : allowedActions) {
-			std::pair<int, int> nextState;
-			auto actionDir = env.actionCoords[action];
-			nextState.first = actionDir.first + m_currentState.first;
-			nextState.second = actionDir.second + m_currentState.second;
-			if (abs(closestAgentState.first - nextState.first) + abs(closestAgentState.second - nextState.second) > agentDist) {
-				actionsToRemove.push_back(action);
-			}
-		}
-		if (actionsToRemove.size() != allowedActions.size()) {
-			for (auto & action : actionsToRemove) {
-				allowedActions.erase(std::remove(allowedActions.begin(), allowedActions.end(), action), allowedActions.end());
-			}
-		}
-	}
-	std::random_device rand_dev;
-	std::mt19937 generator(rand_dev());
+	if (combinedCellDist >= maxIters - 1 - currentIter)
+		mask = am::refine(mask, am::closer(currentState, closestGoal));
+	else // If you can group
+		mask = am::refine(mask, am::notFurther(currentState, env.getClosestAgent(currentState)));
+	return randomAction(mask);
+}
 
-	std::uniform_int_distribution<int>  distr;
-	distr = std::uniform_int_distribution<int>(0, allowedActions.size() - 1);
-	int index = distr(generator);
-	return allowedActions.at(index);
+/// <summary>
+/// Pick a uniformly random action from a mask
+/// </summary>
+int Agent::randomAction(ActionMask mask)
+{
+	return randomAction(mask, m_generator);
+}
+
+int Agent::randomAction(ActionMask mask, std::minstd_rand & random)
+{
+	std::uniform_int_distribution<int> distr(0, am::count(mask) - 1);
+	return am::select(mask, distr(random));
 }
 
 /// <summary>
@@ -334,19 +370,36 @@ tiny_dnn::network<tiny_dnn::sequential> Agent::buildModel()
 	Input layer is 2 (state of agent position as 2 floats) + 
 	2 * number of obstcales and goals combined (each input is 2 floats representing state
 
+	With the local view observation the input is a fixed size image of the cells around the agent
+	so two small 3x3 convolutions replace the first dense layer
 	*/
 
-	int numGoals = m_env.getGoals().size();
-	int numObs = m_env.getNumberOfObstacles();
+	m_encoder.update(m_env);
 
 	// FC is equivalent of Keras dense
 	std::cout << "Build Model" << std::endl;
-	m_inputLayer = 2 + (2 * (numGoals + numObs));
+	m_inputLayer = m_encoder.size();
 	m_outputLayer = 5;
-	m_hiddenLayer = ceil(sqrt(m_inputLayer * m_outputLayer));
-	test_nn
-		<< fully_connected_layer(m_inputLayer, m_hiddenLayer, true) << relu()
-		<< fully_connected_layer(m_hiddenLayer, m_outputLayer, true) << softmax();
+	if (m_encoder.getMode() == QLCObservationLocalView) {
+		const int window = 3;
+		const int channels1 = 8;
+		const int channels2 = 16;
+		int view = m_encoder.getViewSize();
+		int view1 = view - window + 1;
+		int view2 = view1 - window + 1;
+		m_hiddenLayer = 32;
+		test_nn
+			<< convolutional_layer(view, view, window, FeatureEncoder::LOCAL_VIEW_CHANNELS, channels1, padding::valid, true) << relu()
+			<< convolutional_layer(view1, view1, window, channels1, channels2, padding::valid, true) << relu()
+			<< fully_connected_layer(view2 * view2 * channels2, m_hiddenLayer, true) << relu()
+			<< fully_connected_layer(m_hiddenLayer, m_outputLayer, true) << softmax();
+	}
+	else {
+		m_hiddenLayer = ceil(sqrt(m_inputLayer * m_outputLayer));
+		test_nn
+			<< fully_connected_layer(m_inputLayer, m_hiddenLayer, true) << relu()
+			<< fully_connected_layer(m_hiddenLayer, m_outputLayer, true) << softmax();
+	}
 	for (int i = 0; i < test_nn.depth(); i++) {
 		std::cout << "#layer:" << i << "\n";
 		std::cout << "layer type:" << test_nn[i]->layer_type() << "\n";
@@ -360,112 +413,245 @@ tiny_dnn::network<tiny_dnn::sequential> Agent::buildModel()
 }
 
 /// <summary>
-/// Update the target model weights to equal the -
+/// Copy the online network's weights into the target network. Only the parameters are copied, the layers are
+/// never rebuilt. With Polyak updates the target already follows the online network after every gradient step,
+/// so this does nothing
 /// </summary>
 void Agent::updateTargetModel()
 {
-	m_targetModel = m_model;
+	if (m_targetTau < 1.f)
+		return;
+	copyTargetModel();
 }
 
 /// <summary>
-/// Add a memory batch to the replay buffer for training purposes limiting the buffer to a maximum size
+/// Move the target network a step of m_targetTau towards the online network
+/// </summary>
+void Agent::softUpdateTargetModel()
+{
+	if (m_kernel.ready()) {
+		m_targetKernel.blendWeights(m_kernel, m_targetTau);
+		m_kernelDirty = true;
+		return;
+	}
+	mw::blend(m_targetModel, m_model, m_targetTau);
+}
+
+/// <summary>
+/// Copy the online network's parameters into the target. Assigning a tiny_dnn network copies its layer pointers,
+/// the two would then share weights and the target would track every gradient step, so only values are copied
+/// </summary>
+void Agent::copyTargetModel()
+{
+	if (m_kernel.ready()) {
+		m_targetKernel.copyWeights(m_kernel);
+		m_kernelDirty = true;
+		return;
+	}
+	mw::copy(m_targetModel, m_model);
+}
+
+/// <summary>
+/// Add a memory batch to the replay buffer for training purposes, once full the oldest memory is replaced
 /// </summary>
 /// <param name="memory"></param>
 void Agent::replayMemory(AgentMemoryBatch memory)
 {
-	m_memory.push_back(memory);
-	// Keep only maxMemorySize items in memory
-	if (m_memory.size() > maxMemorySize) {
-		m_memory.pop_front();
-	}
+	m_memory.push(memory);
+}
+
+/// <summary>
+/// Number of memories in the replay buffer
+/// </summary>
+int Agent::getReplaySize() const
+{
+	return (int)m_memory.size();
 }
 
 /// <summary>
-/// Pick random samples from within replay memeory in batch size to train the model
+/// Most memories the replay buffer holds before overwriting the oldest
+/// </summary>
+int Agent::getReplayCapacity() const
+{
+	return maxMemorySize;
+}
+
+/// <summary>
+/// Set how many memories the replay buffer holds, this clears the buffer
+/// </summary>
+/// <param name="capacity">Maximum number of stored memories</param>
+void Agent::setReplayCapacity(int capacity)
+{
+	maxMemorySize = std::max(1, capacity);
+	m_memory.setCapacity(maxMemorySize);
+}
+
+/// <summary>
+/// Draw replay memories in proportion to their last TD error
+/// </summary>
+/// <param name="enabled">If replay is prioritized, otherwise it is uniform</param>
+/// <param name="alpha">How strongly priorities skew sampling, 0 is uniform</param>
+/// <param name="beta">Starting importance sampling correction, annealed towards 1</param>
+void Agent::setPrioritizedReplay(bool enabled, float alpha, float beta)
+{
+	m_prioritizedReplay = enabled;
+	m_memory.m_alpha = alpha;
+	m_memory.m_beta = beta;
+}
+
+/// <summary>
+/// Set the number of memories sampled for each gradient step
+/// </summary>
+void Agent::setBatchSize(int batchSize)
+{
+	m_batchSize = std::max(1, batchSize);
+}
+
+int Agent::getBatchSize() const
+{
+	return m_batchSize;
+}
+
+/// <summary>
+/// Seed the replay sampling so a run's minibatches can be reproduced
+/// </summary>
+void Agent::seedReplay(unsigned int seed)
+{
+	m_memory.seed(seed);
+}
+
+/// <summary>
+/// Called once per environment step, fits as many replay minibatches as the training scheduler asks for.
+/// Nothing is trained until the scheduler's warm up has filled some of the replay memory
 /// </summary>
 void Agent::trainReplay()
 {
-	if (m_memory.size() < m_trainStart) {
-		// No full batch preset so do nothing
+	int steps = m_scheduler.step();
+	if (m_memory.empty())
+		return;
+	for (int i = 0; i < steps; ++i) {
+		fitReplayBatch();
+	}
+}
+
+/// <summary>
+/// Pick random samples from within replay memeory in batch size and run one gradient step on them
+/// </summary>
+void Agent::fitReplayBatch()
+{
+	if (m_prioritizedReplay) {
+		m_memory.samplePrioritized(m_batchSize, m_miniBatch, m_sampleSlots, m_sampleWeights);
 	}
 	else {
-		int bs = std::min(m_batchSize, (int)m_memory.size());
-		auto memoryCopy = m_memory;
-		std::random_shuffle(memoryCopy.begin(), memoryCopy.end());
-		std::vector<AgentMemoryBatch> miniBatch;
-		for (int i = 0; i < bs; ++i) {
-			miniBatch.push_back(memoryCopy.at(i));
-		}
+		m_memory.sample(m_batchSize, m_miniBatch, m_replayWithReplacement);
+		m_sampleWeights.assign(m_miniBatch.size(), 1.f);
+	}
+	int bs = (int)m_miniBatch.size();
+	if (bs == 0)
+		return;
+	m_encoder.update(m_env);
+	if (m_kernel.ready()) {
+		fitReplayBatchKernel(bs);
+	}
+	else {
+		fitReplayBatchModel(bs);
+	}
+	if (m_targetTau < 1.f)
+		softUpdateTargetModel();
+}
 
-		std::vector<tiny_dnn::vec_t> updateInput;
-		std::vector<tiny_dnn::vec_t> updateTarget;
-		updateInput.resize(m_batchSize);
-		updateTarget.resize(m_batchSize);
-		for (int batch = 0; batch < m_batchSize; ++batch) {
-			updateInput.at(batch).resize(m_inputLayer);
-			updateTarget.at(batch).resize(m_outputLayer);
-			for (auto & input : updateInput.at(batch)) {
-				input = 0;
-			}
-			for (auto & targ : updateTarget.at(batch)) {
-				targ = 0;
-			}
-		}
+/// <summary>
+/// The replay step on the tiny_dnn models
+/// </summary>
+/// <param name="bs">Number of memories sampled into the minibatch</param>
+void Agent::fitReplayBatchModel(int bs)
+{
+	allocateBatches(bs);
+
+	// Encode the whole minibatch so the online and target values each come from one batched forward pass.
+	// Terminal memories are encoded in the next state batch as well to keep the batch a fixed size, their output is unused
+	for (int i = 0; i < bs; ++i) {
+		auto & currentMemory = *m_miniBatch[i];
+		m_encoder.encode(currentMemory.state, m_stateBatch[i][0].data());
+		m_encoder.encode(currentMemory.nextState, m_nextStateBatch[i][0].data());
+	}
+	std::vector<tiny_dnn::tensor_t> predicted = m_model.predict(m_stateBatch);
+	std::vector<tiny_dnn::tensor_t> nextPredicted = m_targetModel.predict(m_nextStateBatch);
+
+	for (int i = 0; i < bs; ++i) {
+		auto & currentMemory = *m_miniBatch[i];
+		tiny_dnn::vec_t & target = m_targetBatch[i][0];
+		std::copy(predicted[i][0].begin(), predicted[i][0].end(), target.begin());
+		float error = replayTarget(currentMemory, target.data(), nextPredicted[i][0].data(), m_sampleWeights[i]);
+		if (m_prioritizedReplay)
+			m_memory.updatePriority(m_sampleSlots[i], error);
+	}
+	// Train the model, the optimizer is kept so its moment estimates carry across steps
+	m_model.fit<tiny_dnn::mse>(m_optimizer, m_stateBatch, m_targetBatch, m_batchSize, 1);
+}
 
-		for (int i = 0; i < bs; ++i) {
-			auto & currentMemory = miniBatch[i];
-			tiny_dnn::vec_t states;
-
-			// Get the state items
-			auto goals = m_env.getGoals();
-			auto obstacles = m_env.getObstacles();
-			// Convert environment values into input for neural net
-			states.push_back(currentMemory.state.first);
-			states.push_back(currentMemory.state.second);
-			for (auto & goal : goals) {
-				states.push_back(currentMemory.state.first - goal.first);
-				states.push_back(currentMemory.state.second - goal.second);
-			}
-			for (auto & obs : obstacles) {
-				states.push_back(currentMemory.state.first - obs.first);
-				states.push_back(currentMemory.state.second - obs.second);
-			}
-			// Run a prediction
-			tiny_dnn::vec_t target = m_model.predict(states);
-
-			if (m_done)
-				target[currentMemory.action] = currentMemory.reward;
-			else {
-				// Convert environment values into input for neural net
-				tiny_dnn::vec_t next_states;
-				next_states.push_back(currentMemory.nextState.first);
-				next_states.push_back(currentMemory.nextState.second);
-				for (auto & goal : goals) {
-					next_states.push_back(currentMemory.nextState.first - goal.first);
-					next_states.push_back(currentMemory.nextState.second - goal.second);
-				}
-				for (auto & obs : obstacles) {
-					next_states.push_back(currentMemory.nextState.first - obs.first);
-					next_states.push_back(currentMemory.nextState.second - obs.second);
-				}
-				// Run a prediction
-				auto predicted = m_model.predict(next_states);
-				// Get the max Element
-				auto maxElement = *std::max_element(predicted.begin(), predicted.end());
-				//Q[state.first][state.second][action] += beta * (reward + gamma * maxElement - sa);
-				auto val = currentMemory.reward + ((tiny_dnn::float_t)m_gamma * maxElement);
-				for (int i = 0; i < m_outputLayer; ++i) {
-					target[i] = val;
-				}
-			}
-
-			updateInput[i] = states;
-			updateTarget[i] = target;
-		}
-		tiny_dnn::adam opt;
-		// Train the model
-		m_model.fit<tiny_dnn::mse>(opt, updateInput, updateTarget, m_batchSize, 1);
+/// <summary>
+/// The replay step on the fused kernel, the minibatch is encoded into flat arrays and trained in place
+/// </summary>
+/// <param name="bs">Number of memories sampled into the minibatch</param>
+void Agent::fitReplayBatchKernel(int bs)
+{
+	int inputs = m_kernel.getInputs();
+	int outputs = m_kernel.getOutputs();
+	m_kernelStates.resize(bs * inputs);
+	m_kernelNextStates.resize(bs * inputs);
+	m_kernelTargets.resize(bs * outputs);
+	m_kernelNextValues.resize(bs * outputs);
+	for (int i = 0; i < bs; ++i) {
+		m_encoder.encode(m_miniBatch[i]->state, &m_kernelStates[i * inputs]);
+		m_encoder.encode(m_miniBatch[i]->nextState, &m_kernelNextStates[i * inputs]);
 	}
+	m_kernel.forwardBatch(m_kernelStates.data(), bs, m_kernelTargets.data());
+	m_targetKernel.forwardBatch(m_kernelNextStates.data(), bs, m_kernelNextValues.data());
+	for (int i = 0; i < bs; ++i) {
+		float error = replayTarget(*m_miniBatch[i], &m_kernelTargets[i * outputs], &m_kernelNextValues[i * outputs], m_sampleWeights[i]);
+		if (m_prioritizedReplay)
+			m_memory.updatePriority(m_sampleSlots[i], error);
+	}
+	m_kernel.train(m_kernelStates.data(), m_kernelTargets.data(), bs, m_gradientWorkers);
+	m_kernelDirty = true;
+}
+
+/// <summary>
+/// Turn the online prediction of a memory's state into its training target
+/// </summary>
+/// <param name="memory">The replayed memory</param>
+/// <param name="target">The online prediction for the state, overwritten with the target</param>
+/// <param name="next">The target model's prediction for the next state</param>
+/// <param name="weight">Importance sampling weight of the memory, 1 for uniform replay</param>
+/// <returns>The TD error of the memory</returns>
+float Agent::replayTarget(const AgentMemoryBatch & memory, float * target, const float * next, float weight) const
+{
+	float value = memory.reward;
+	if (!memory.done) {
+		// Bootstrap from the target model so the target does not chase the network being fitted
+		float maxElement = *std::max_element(next, next + m_outputLayer);
+		value += m_gamma * maxElement;
+	}
+	// Only the taken action is moved, the others keep the online prediction and add no error.
+	// Moving it part way scales the mse gradient, which is how the importance sampling weight is applied
+	float error = value - target[memory.action];
+	target[memory.action] += weight * error;
+	return error;
+}
+
+/// <summary>
+/// Size the minibatch tensors once so encoding writes straight into them every step
+/// </summary>
+/// <param name="batchSize">Number of memories in the minibatch</param>
+void Agent::allocateBatches(int batchSize)
+{
+	int inputSize = m_encoder.size();
+	if ((int)m_stateBatch.size() == batchSize && !m_stateBatch.empty() && (int)m_stateBatch[0][0].size() == inputSize)
+		return;
+	m_stateBatch.assign(batchSize, tiny_dnn::tensor_t(1, tiny_dnn::vec_t(inputSize)));
+	m_nextStateBatch.assign(batchSize, tiny_dnn::tensor_t(1, tiny_dnn::vec_t(inputSize)));
+	m_targetBatch.assign(batchSize, tiny_dnn::tensor_t(1, tiny_dnn::vec_t(m_outputLayer)));
 }
 
 /// <summary>
@@ -473,20 +659,12 @@ void Agent::trainReplay()
 /// </summary>
 void Agent::resizeQTable()
 {
-	Q.clear();
 	m_stateDim = m_env.getStateDim();
 	m_actionDim = m_env.getActionDim();
-	for (int row = 0; row < m_stateDim.first; ++row) {
-		std::vector<std::vector<float>> newRow;
-		for (int col = 0; col < m_stateDim.second; ++col) {
-			std::vector<float> actions;
-			for (int a = 0; a < m_actionDim.first; ++a) {
-				actions.push_back(0);
-			}
-			newRow.push_back(actions);
-		}
-		Q.push_back(newRow);
-	}
+	if (!m_sharedTable)
+		Q.resize(m_stateDim.first, m_stateDim.second, m_actionDim.first);
+	m_planner.resize(m_stateDim.first, m_stateDim.second, m_actionDim.first);
+	m_convergence.resize(m_stateDim.first, m_stateDim.second);
 }
 
 /// <summary>
@@ -498,111 +676,210 @@ void Agent::resizeStates()
 	m_actionDim = m_env.getActionDim();
 }
 
+/// <summary>
+/// Choose what the DQN observes, must be called before the models are built
+/// </summary>
+/// <param name="observation">The observation to encode states with</param>
+/// <param name="viewRadius">Cells seen in each direction by the local view</param>
+void Agent::setObservation(QLCObservation observation, int viewRadius)
+{
+	m_encoder.setMode(observation, viewRadius);
+}
+
 void Agent::initModels()
 {
+	// Both networks are built separately and initialised up front, after this the target only ever takes values
 	m_model = buildModel();
 	m_targetModel = buildModel();
+	m_model.init_weight();
+	m_targetModel.init_weight();
+	mw::copy(m_targetModel, m_model);
+	m_scheduler.reset();
+	m_optimizer.clear();
+	m_kernel = MlpKernel();
+	m_targetKernel = MlpKernel();
+	m_kernelDirty = false;
+	if (m_fusedKernel && m_encoder.getMode() == QLCObservationOffsets)
+		reloadKernels();
+}
+
+QLCObservation Agent::getObservation() const
+{
+	return m_encoder.getMode();
+}
+
+int Agent::getViewRadius() const
+{
+	return m_encoder.getViewRadius();
 }
 
 /// <summary>
-/// display the generated optimal policy of the agent in relation to the given environment
+/// Copy the online model's parameters into one array in the ModelWeights order
 /// </summary>
-/// <param name="env">The given environment the agent trained in</param>
-void Agent::displayGreedyPolicy(Environment & env)
+std::vector<float> Agent::exportWeights()
 {
+	return mw::flatten(getModel());
+}
 
-	std::vector<std::string> action_dict = { "u", "r", "d", "l", "n" };
+/// <summary>
+/// Overwrite the online model's parameters from an array made by exportWeights of an agent with the same model
+/// </summary>
+/// <param name="weights">The parameters to load</param>
+/// <returns>If the parameter count matched the model</returns>
+bool Agent::importWeights(const std::vector<float> & weights)
+{
+	syncModels();
+	if (!mw::unflatten(m_model, weights.data(), weights.size()))
+		return false;
+	if (m_kernel.ready())
+		m_kernel.load(m_model);
+	return true;
+}
 
-	std::vector<std::vector<std::string>> greedyPolicy;
-	greedyPolicy.resize(m_stateDim.first);
-	for (int row = 0; row < m_stateDim.first; ++row) {
-		std::cout << "[";
-		greedyPolicy.at(row).resize(m_stateDim.second);
-		for (int col = 0; col < m_stateDim.second; ++col) {
-			if (env.m_tileFlags[row][col] & QLCTileGoal) {
-				greedyPolicy[row][col] = "g";
-			}
-			else if (env.m_tileFlags[row][col] & QLCTileObstacle) {
-				greedyPolicy[row][col] = "o";
-			}
-			else {
-				auto actions = Q[row][col];
-				greedyPolicy[row][col] = *std::max_element(actions.begin(), actions.end());
-				float best = actions.at(0);
-				int selected = 0;
-				for (int i = 1; i < actions.size(); ++i) {
-					if (actions[i] > best) {
-						best = actions[i];
-						selected = i;
-					}
-				}
-				greedyPolicy[row][col] = action_dict.at(selected);
-			}
-			std::cout << greedyPolicy[row][col] << ",";
-		}
-		std::cout << "]," << std::endl;
+/// <summary>
+/// Write the online model as a policy file for the PolicyRuntime, along with how its inputs are encoded.
+/// With calibration states the policy is also calibrated for int8 inference on states from the replay memory
+/// </summary>
+/// <param name="path">Path of the policy file</param>
+/// <param name="calibrationStates">Replay states to calibrate the int8 scales on, 0 exports fp32 only</param>
+/// <returns>If every layer could be exported and the file was written</returns>
+bool Agent::exportPolicy(const std::string & path, int calibrationStates)
+{
+	PolicyWriter writer;
+	writer.setObservation(m_encoder.getMode(), m_encoder.getViewRadius());
+	if (!writer.addModel(getModel()) || !writer.save(path))
+		return false;
+	if (calibrationStates <= 0 || m_memory.empty())
+		return true;
+
+	std::vector<State> states;
+	std::vector<float> features;
+	getReplayStates(calibrationStates, states);
+	encodeStates(states, features);
+	std::vector<float> scales;
+	{
+		PolicyRuntime runtime;
+		if (!runtime.open(path) || !runtime.calibrate(features.data(), (int)states.size(), scales))
+			return false;
 	}
+	return writer.setInputScales(scales) && writer.save(path);
 }
 
 /// <summary>
-/// reset the agents training values
+/// Up to count states spread evenly over the replay memory
 /// </summary>
-void Agent::reset()
+void Agent::getReplayStates(int count, std::vector<State> & states) const
 {
-	m_epsilon = 1.f;
-	m_epsilonDecay = 0.99f;
-	//beta = 0.99f; // Disable this to allow defining learning rates
-	m_gamma = 0.99f;
-	for (int row = 0; row < m_stateDim.first; ++row) {
-		for (int col = 0; col < m_stateDim.second; ++col) {
-			for (int action = 0; action < m_actionDim.first; ++action) {
-				Q[row][col][action] = 0;
-			}
-		}
+	states.clear();
+	size_t size = m_memory.size();
+	if (count <= 0 || size == 0)
+		return;
+	size_t taken = std::min(size, (size_t)count);
+	for (size_t i = 0; i < taken; ++i) {
+		states.push_back(m_memory[i * size / taken].state);
 	}
 }
 
 /// <summary>
-/// Set the orientation of the agent sprite in accordance with the action
+/// Encode states as the network's input, one row after another
 /// </summary>
-/// <param name="action">The agents given action</param>
-void Agent::setOrientation(int action)
+void Agent::encodeStates(const std::vector<State> & states, std::vector<float> & features)
 {
-	switch (action)
-	{
-	case 0:
-		m_angle = -90;
-		break;
-	case 1:
-		m_angle = 0;
-		break;
-	case 2:
-		m_angle = 90;
-		break;
-	case 3:
-		m_angle = 180;
-		break;
-	default:
-		m_angle = 0;
-		break;
+	m_encoder.update(m_env);
+	int inputSize = m_encoder.size();
+	features.resize(states.size() * inputSize);
+	for (size_t i = 0; i < states.size(); ++i) {
+		m_encoder.encode(states[i], &features[i * inputSize]);
+	}
+}
+
+/// <summary>
+/// Copy the tiny_dnn models into the fused kernels, needed after anything writes the models directly
+/// </summary>
+void Agent::reloadKernels()
+{
+	if (!m_fusedKernel || m_encoder.getMode() != QLCObservationOffsets)
+		return;
+	if (!m_kernel.load(m_model) || !m_targetKernel.load(m_targetModel)) {
+		m_kernel = MlpKernel();
+		m_targetKernel = MlpKernel();
 	}
+	m_kernelDirty = false;
 }
 
 /// <summary>
-/// Render the agent to the sdl render window
+/// Write the fused kernels' weights back into the tiny_dnn models if they have trained since the last sync
 /// </summary>
-/// <param name="renderer"></param>
-void Agent::render(SDL_Renderer & renderer)
+void Agent::syncModels()
 {
-	m_sprite.render(&renderer, m_angle);
+	if (!m_kernelDirty)
+		return;
+	m_kernel.store(m_model);
+	m_targetKernel.store(m_targetModel);
+	m_kernelDirty = false;
 }
 
-void Agent::setPosition(float x, float y)
+/// <summary>
+/// Get the online DQN model
+/// </summary>
+tiny_dnn::network<tiny_dnn::sequential> & Agent::getModel()
 {
-	m_sprite.setPosition(x, y);
+	syncModels();
+	return m_model;
 }
 
-void Agent::setSize(float w, float h)
+/// <summary>
+/// Get the DQN target model
+/// </summary>
+tiny_dnn::network<tiny_dnn::sequential> & Agent::getTargetModel()
+{
+	syncModels();
+	return m_targetModel;
+}
+
+/// <summary>
+/// display the generated optimal policy of the agent in relation to the given environment
+/// </summary>
+/// <param name="env">The given environment the agent trained in</param>
+void Agent::displayGreedyPolicy(Environment & env)
+{
+	const char actionNames[] = { 'u', 'r', 'd', 'l', 'n' };
+	for (int row = 0; row < m_stateDim.first; ++row) {
+		std::cout << "[";
+		for (int col = 0; col < m_stateDim.second; ++col) {
+			char cell;
+			if (env.m_tileFlags[row][col] & QLCTileGoal)
+				cell = 'g';
+			else if (env.m_tileFlags[row][col] & QLCTileObstacle)
+				cell = 'o';
+			else
+				cell = actionNames[Q.greedyAction(row, col)];
+			std::cout << cell << ",";
+		}
+		std::cout << "]," << std::endl;
+	}
+}
+
+/// <summary>
+/// reset the agents training values
+/// </summary>
+void Agent::reset()
+{
+	//beta = 0.99f; // Disable this to allow defining learning rates
+	m_gamma = 0.99f;
+	m_planner.reset();
+	m_convergence.reset();
+	m_scheduler.reset();
+	m_optimizer.clear();
+	m_kernel.resetOptimizer();
+	if (!m_sharedTable)
+		Q.clear();
+}
+
+/// <summary>
+/// If the agent learns into a Q table shared with other agents
+/// </summary>
+bool Agent::sharesTable() const
 {
-	m_sprite.setBounds(w, h);
+	return m_sharedTable;
 }
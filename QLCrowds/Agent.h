@@ -5,10 +5,18 @@
 #include <vector>
 #include <tuple>
 #include <random>
+#include <memory>
 
 #include "Environment.h"
-#include "Sprite.h"
-#include <SDL_render.h>
+#include "Planner.h"
+#include "ConvergenceTracker.h"
+#include "QTable.h"
+#include "ReplayBuffer.h"
+#include "FeatureEncoder.h"
+#include "TrainingScheduler.h"
+#include "PersistentAdam.h"
+#include "MlpKernel.h"
+#include "PolicyWriter.h"
 #include <tiny_dnn/tiny_dnn.h>
 
 typedef std::pair<int, int> State;
@@ -23,74 +31,158 @@ public:
 		bool done;
 	};
 
-	Agent(Environment & env, SDL_Renderer * renderer);
+	struct EligibilityTrace {
+		State state;
+		int action;
+		float value;
+	};
+
+	Agent(Environment & env, std::shared_ptr<QTable> sharedTable = nullptr);
 	~Agent();
 
 	std::pair<int, int> m_stateDim;
 	std::pair<int, int> m_actionDim;
 
-	float m_epsilon = 1.f;			// Initial exploration prob
-	float m_epsilonDecay = 0.9999f;	// Epsilon decay after each episode
 	float m_beta = 0.99f;				// Learning Rate
 	float m_gamma = 0.99f;			// Discount factor
+	float m_lambda = 0.9f;			// Eligibility trace decay
+	float m_traceCutoff = 0.01f;		// Traces below this value are dropped from the active list
 
-	std::vector<std::vector<std::vector<float>>> Q; //Q Table for action state coupling
-	bool m_done = false;
+	std::shared_ptr<QTable> m_table;	// Q table storage, either owned or shared by a crowd
+	QTable & Q; //Q Table for action state coupling
 
 	// Backtracking controls
-	std::pair<int, int> m_currentState;
-	std::pair<int, int> m_previousState;
 	bool m_backTracking = false;
 
+	// Model based planning controls
+	bool m_planning = false;
+	int m_planningSteps = 5;			// Planning backups per real step
+
+	// Convergence tracking, fed by every real experience update
+	ConvergenceTracker m_convergence;
+
 	// General functions
 	void reset();
 
-	// Action functions
-	int getAction(Environment & env);
-	int getActionRBMBased(Environment & env);
-	int getMultiAgentActionRBM(Environment & env, int currentIter, const int maxIters);
+	// Action functions, the ones given a generator draw from it so many agents can act with one learner
+	int getAction(Environment & env, const State & currentState, const State & previousState, float epsilon, std::minstd_rand & random, bool * isGreedy = nullptr);
+	int getActionDQN(Environment & env, const State & currentState, const State & previousState, float epsilon);
+	int getActionDQN(Environment & env, const State & currentState, const State & previousState, const float * values, std::minstd_rand & random);
+	bool explores(float epsilon, std::minstd_rand & random);
+	int getActionRBMBased(Environment & env, const State & currentState);
+	int getMultiAgentActionRBM(Environment & env, const State & currentState, const State & previousState, int currentIter, const int maxIters);
 
 	// Learning function
 	void train(std::tuple<std::pair<int,int>, int, std::pair<int, int>, float, bool> t);
+	void trainLambda(std::tuple<std::pair<int, int>, int, std::pair<int, int>, float, bool> t, std::vector<EligibilityTrace> & traces, int nextAction = -1);
+	void trainTarget(const State & state, int action, float target);
 	
+	// Replay sampling, without replacement a batch never repeats an experience
+	bool m_replayWithReplacement = false;
+
+	// Gradient steps run for each environment step of DQN training
+	TrainingScheduler m_scheduler;
+
+	// Run the two layer DQN on the fused kernel instead of tiny_dnn, takes effect when the models are built
+	bool m_fusedKernel = false;
+
+	// Threads the fused kernel shards each minibatch's gradient over, the training thread alone if null
+	WorkerPool * m_gradientWorkers = nullptr;
+
+	// Target network updates, 1 copies the online weights when asked, below 1 Polyak averages them in every gradient step
+	float m_targetTau = 1.f;
+
 	// NN function approximator work
+	void setReplayCapacity(int capacity);
+	void setBatchSize(int batchSize);
+	int getBatchSize() const;
+	void seedReplay(unsigned int seed);
+	void setPrioritizedReplay(bool enabled, float alpha = 0.6f, float beta = 0.4f);
 	void updateTargetModel();
+	void softUpdateTargetModel();
 	void replayMemory(AgentMemoryBatch memory);
 	void trainReplay();
+	void fitReplayBatch();
+	int getReplaySize() const;
+	int getReplayCapacity() const;
 	void resizeQTable();
 	void resizeStates();
+	void setObservation(QLCObservation observation, int viewRadius = 4);
+	QLCObservation getObservation() const;
+	int getViewRadius() const;
 	void initModels();
+	void reloadKernels();
+	void predictBatch(const std::vector<State> & states, std::vector<float> & values);
+	std::vector<float> exportWeights();
+	bool importWeights(const std::vector<float> & weights);
+	bool exportPolicy(const std::string & path, int calibrationStates = 0);
+	void getReplayStates(int count, std::vector<State> & states) const;
+	void encodeStates(const std::vector<State> & states, std::vector<float> & features);
+	tiny_dnn::network<tiny_dnn::sequential> & getModel();
+	tiny_dnn::network<tiny_dnn::sequential> & getTargetModel();
 
 	// Debug functions
 	void displayGreedyPolicy(Environment & env);
 	
-	// Render functions
-	void setOrientation(int action);
-	void render(SDL_Renderer & renderer);
-	
-
-	// Setters
-	void setPosition(float x, float y);
-	void setSize(float w, float h);
+	bool sharesTable() const;
 private:
 	// NN approximator work
 	tiny_dnn::network<tiny_dnn::sequential> m_model;
 	tiny_dnn::network<tiny_dnn::sequential> m_targetModel;
+	void copyTargetModel();
 	int m_inputLayer;
 	int m_outputLayer;
 	int m_hiddenLayer;
 
 	tiny_dnn::network<tiny_dnn::sequential> buildModel();
 
-	int m_trainStart = 100;
 	int m_batchSize = 32;
 	int maxMemorySize = 1000;
-	std::deque<AgentMemoryBatch> m_memory;
+	ReplayBuffer<AgentMemoryBatch> m_memory;
+	std::vector<const AgentMemoryBatch *> m_miniBatch;
+
+	// Cached input encoding and minibatch tensors reused every replay step
+	FeatureEncoder m_encoder;
+	std::vector<tiny_dnn::tensor_t> m_stateBatch;
+	std::vector<tiny_dnn::tensor_t> m_nextStateBatch;
+	std::vector<tiny_dnn::tensor_t> m_targetBatch;
+	void allocateBatches(int batchSize);
+
+	// One optimizer for the life of the model so Adam's moments persist
+	PersistentAdam m_optimizer;
+	float replayTarget(const AgentMemoryBatch & memory, float * target, const float * next, float weight) const;
+
+	// Prioritized replay, the slots drawn and their importance sampling weights
+	bool m_prioritizedReplay = false;
+	std::vector<size_t> m_sampleSlots;
+	std::vector<float> m_sampleWeights;
+
+	// Fused kernels mirroring m_model and m_targetModel, the models are only brought up to date when read
+	MlpKernel m_kernel;
+	MlpKernel m_targetKernel;
+	bool m_kernelDirty = false;
+	tiny_dnn::vec_t m_encoded;
+	std::vector<float> m_kernelStates;
+	std::vector<float> m_kernelNextStates;
+	std::vector<float> m_kernelTargets;
+	std::vector<float> m_kernelNextValues;
+	std::vector<float> m_inferenceInputs;
+	std::vector<tiny_dnn::tensor_t> m_inferenceBatch;
+	void fitReplayBatchModel(int bs);
+	void fitReplayBatchKernel(int bs);
+	void syncModels();
+
+	// Model of observed transitions used for planning backups
+	Planner m_planner;
+	void plan(const std::tuple<std::pair<int, int>, int, std::pair<int, int>, float, bool> & t);
 
-	Sprite m_sprite;
 	Environment & m_env;
-	// Rendering
-	int m_angle = 0;
+	bool m_sharedTable = false;
+
+	// Action selection
+	std::minstd_rand m_generator;
+	int randomAction(ActionMask mask);
+	int randomAction(ActionMask mask, std::minstd_rand & random);
 };
 
 #endif //!AGENT_H
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "AgentPool.h"
+#include <algorithm>
+
+/// <summary>
+/// Default agent pool constructor
+/// </summary>
+AgentPool::AgentPool() :
+	m_seeds(std::random_device()())
+{
+}
+
+/// <summary>
+/// Agent pool deconstructor, deletes every learner
+/// </summary>
+AgentPool::~AgentPool()
+{
+	clear();
+}
+
+/// <summary>
+/// Get the number of agents in the pool
+/// </summary>
+int AgentPool::size() const
+{
+	return m_agents.size();
+}
+
+/// <summary>
+/// Get the learner of an agent
+/// </summary>
+/// <param name="index">The agent index</param>
+/// <returns>Pointer to the agents learner</returns>
+Agent * AgentPool::at(int index)
+{
+	return m_agents.at(index);
+}
+
+/// <summary>
+/// Add an agent with its own learner to the pool, the pool takes ownership of the learner
+/// </summary>
+/// <param name="learner">The learner of the new agent</param>
+void AgentPool::add(Agent * learner)
+{
+	m_learners.push_back(learner);
+	addRow(learner, true);
+}
+
+/// <summary>
+/// Add an agent acting and learning with a learner already in the pool
+/// </summary>
+/// <param name="learner">A learner of an earlier agent</param>
+void AgentPool::addMember(Agent * learner)
+{
+	addRow(learner, false);
+}
+
+/// <summary>
+/// Remove the last agent in the pool, deleting its learner if the agent brought it
+/// </summary>
+void AgentPool::removeBack()
+{
+	if (m_ownsLearner.back()) {
+		delete m_learners.back();
+		m_learners.pop_back();
+	}
+	m_currentState.pop_back();
+	m_previousState.pop_back();
+	m_done.pop_back();
+	m_epsilon.pop_back();
+	m_epsilonDecay.pop_back();
+	m_random.pop_back();
+	m_nextAction.pop_back();
+	m_agents.pop_back();
+	m_traces.pop_back();
+	m_position.pop_back();
+	m_angle.pop_back();
+	m_ownsLearner.pop_back();
+}
+
+/// <summary>
+/// Remove and delete every agent in the pool
+/// </summary>
+void AgentPool::clear()
+{
+	while (!m_agents.empty()) {
+		removeBack();
+	}
+}
+
+/// <summary>
+/// Check if every agent has finished its episode
+/// </summary>
+bool AgentPool::allDone() const
+{
+	return std::find(m_done.begin(), m_done.end(), false) == m_done.end();
+}
+
+/// <summary>
+/// Set the done flag of every agent
+/// </summary>
+void AgentPool::setAllDone(bool done)
+{
+	std::fill(m_done.begin(), m_done.end(), done);
+}
+
+/// <summary>
+/// Decay the exploration probability of every agent after an episode
+/// </summary>
+/// <param name="minimum">The lowest the exploration probability can decay to</param>
+void AgentPool::decayEpsilon(float minimum)
+{
+	for (size_t i = 0; i < m_epsilon.size(); ++i) {
+		m_epsilon[i] = std::max(m_epsilon[i] * m_epsilonDecay[i], minimum);
+	}
+}
+
+/// <summary>
+/// Reset the exploration values of every agent for a new run
+/// </summary>
+void AgentPool::resetExploration()
+{
+	std::fill(m_epsilon.begin(), m_epsilon.end(), 1.f);
+	std::fill(m_epsilonDecay.begin(), m_epsilonDecay.end(), 0.99f);
+}
+
+/// <summary>
+/// Clear an agent's per episode learning state, its pending action and eligibility traces
+/// </summary>
+void AgentPool::resetEpisode(int index)
+{
+	m_nextAction[index] = -1;
+	m_traces[index].clear();
+}
+
+/// <summary>
+/// Load the texture drawn for every agent
+/// </summary>
+/// <param name="path">Filepath to the texture</param>
+/// <param name="renderer">The sdl renderer used for texture construction</param>
+void AgentPool::loadTexture(std::string path, SDL_Renderer * renderer)
+{
+	m_sprite.loadTexture(path, renderer);
+}
+
+/// <summary>
+/// Set the draw size of every agent
+/// </summary>
+void AgentPool::setSize(int w, int h)
+{
+	m_sprite.setBounds(w, h);
+}
+
+/// <summary>
+/// Set the draw position of an agent
+/// </summary>
+void AgentPool::setPosition(int index, float x, float y)
+{
+	m_position[index] = { (int)x, (int)y };
+}
+
+/// <summary>
+/// Set the orientation of an agent sprite in accordance with the action
+/// </summary>
+/// <param name="index">The agent index</param>
+/// <param name="action">The agents given action</param>
+void AgentPool::setOrientation(int index, int action)
+{
+	switch (action)
+	{
+	case 0:
+		m_angle[index] = -90;
+		break;
+	case 1:
+		m_angle[index] = 0;
+		break;
+	case 2:
+		m_angle[index] = 90;
+		break;
+	case 3:
+		m_angle[index] = 180;
+		break;
+	default:
+		m_angle[index] = 0;
+		break;
+	}
+}
+
+/// <summary>
+/// Render every agent to the sdl render window
+/// </summary>
+/// <param name="renderer">SDL renderer to render to</param>
+void AgentPool::render(SDL_Renderer & renderer)
+{
+	for (size_t i = 0; i < m_agents.size(); ++i) {
+		m_sprite.setPosition(m_position[i].x, m_position[i].y);
+		m_sprite.render(&renderer, m_angle[i]);
+	}
+}
+
+/// <summary>
+/// Append the row of a new agent with fresh exploration values and its own action draws
+/// </summary>
+void AgentPool::addRow(Agent * learner, bool ownsLearner)
+{
+	m_currentState.push_back(State(0, 0));
+	m_previousState.push_back(State(0, 0));
+	m_done.push_back(false);
+	m_epsilon.push_back(1.f);
+	m_epsilonDecay.push_back(0.9999f);
+	m_random.push_back(std::minstd_rand(m_seeds()));
+	m_nextAction.push_back(-1);
+	m_agents.push_back(learner);
+	m_traces.push_back(std::vector<Agent::EligibilityTrace>());
+	m_position.push_back({ 0, 0 });
+	m_angle.push_back(0);
+	m_ownsLearner.push_back(ownsLearner);
+}
@@ -0,0 +1,67 @@
+#ifndef AGENTPOOL_H
+#define AGENTPOOL_H
+
+#include <vector>
+#include <random>
+#include <SDL_render.h>
+
+#include "Agent.h"
+#include "Sprite.h"
+
+/// <summary>
+/// Storage for every agent in the simulation laid out as a structure of arrays.
+/// The fields touched every simulation step live in parallel arrays indexed by agent so sweeps over the crowd
+/// only read contiguous memory. Learners, models and rendering data are kept out of line.
+/// An agent is a row acting with a learner, its own in individual mode or one learner shared by the whole
+/// crowd in shared policy mode, so a crowd member costs its row and nothing of the learner's replay memory,
+/// models, planner or convergence tracking.
+/// </summary>
+class AgentPool {
+public:
+	AgentPool();
+	~AgentPool();
+
+	// Hot simulation fields
+	std::vector<State> m_currentState;
+	std::vector<State> m_previousState;
+	std::vector<unsigned char> m_done;
+	std::vector<float> m_epsilon;			// Exploration prob
+	std::vector<float> m_epsilonDecay;		// Epsilon decay after each episode
+	std::vector<std::minstd_rand> m_random;	// Action selection draws, per agent so agents sharing a learner stay independent
+	std::vector<int> m_nextAction;			// SARSA(lambda) action already chosen for the next step, -1 if none
+
+	// Cold data
+	std::vector<Agent *> m_agents;			// The learner of each agent
+	std::vector<Agent *> m_learners;		// Every distinct learner, owned by the pool
+	std::vector<std::vector<Agent::EligibilityTrace>> m_traces;
+	std::vector<SDL_Point> m_position;
+	std::vector<int> m_angle;
+
+	int size() const;
+	Agent * at(int index);
+	void add(Agent * learner);
+	void addMember(Agent * learner);
+	void removeBack();
+	void clear();
+
+	bool allDone() const;
+	void setAllDone(bool done);
+	void decayEpsilon(float minimum);
+	void resetExploration();
+	void resetEpisode(int index);
+
+	// Rendering
+	void loadTexture(std::string path, SDL_Renderer * renderer);
+	void setSize(int w, int h);
+	void setPosition(int index, float x, float y);
+	void setOrientation(int index, int action);
+	void render(SDL_Renderer & renderer);
+private:
+	Sprite m_sprite;	// One sprite drawn at every agent position
+	std::vector<unsigned char> m_ownsLearner;	// If the agent was added with its learner, which goes with it
+	std::mt19937 m_seeds;
+
+	void addRow(Agent * learner, bool ownsLearner);
+};
+
+#endif //!AGENTPOOL_H
@@ -0,0 +1,165 @@
+#include "AsyncDQNTrainer.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+/// <summary>
+/// Default asynchronous DQN trainer constructor
+/// </summary>
+AsyncDQNTrainer::AsyncDQNTrainer() :
+	m_activeActors(0),
+	m_environmentSteps(0)
+{
+}
+
+AsyncDQNTrainer::~AsyncDQNTrainer()
+{
+}
+
+/// <summary>
+/// Train the learner until the actors have run the episodes between them, see ActorEnvironments for how
+/// episodes are shared out. The heat maps of the actors' environments are merged back into env.
+/// </summary>
+/// <param name="learner">The agent whose models and replay memory are trained, only touched by the learner thread while running</param>
+/// <param name="env">The environment every actor takes a copy of and the learner encodes its states in</param>
+/// <param name="numEpisodes">Episodes to run across all actors</param>
+/// <param name="maxIterations">Step limit of an episode</param>
+/// <param name="epsilon">Exploration rate of the first episode</param>
+/// <param name="epsilonDecay">Exploration decay per episode</param>
+/// <returns>Step counts and duration of the run</returns>
+AsyncDQNTrainer::Stats AsyncDQNTrainer::run(Agent & learner, Environment & env, int numEpisodes, int maxIterations, float epsilon, float epsilonDecay)
+{
+	int numActors = std::max(1, m_numActors);
+	auto start = std::chrono::steady_clock::now();
+
+	// Environments first so the actor agents can hold references to copies that no longer move
+	m_queues.clear();
+	m_actors.clear();
+	m_envs.create(env, numActors);
+	m_envs.startEpisodes(numEpisodes, epsilon, epsilonDecay, m_minEpsilon);
+	for (int i = 0; i < numActors; ++i) {
+		m_queues.emplace_back(new SPSCQueue<Agent::AgentMemoryBatch>(m_queueCapacity));
+		m_actors.emplace_back(new Agent(m_envs.at(i)));
+		Agent & actor = *m_actors.back();
+		actor.m_backTracking = learner.m_backTracking;
+		actor.m_fusedKernel = learner.m_fusedKernel;
+		actor.setObservation(learner.getObservation(), learner.getViewRadius());
+		actor.initModels();
+	}
+	publish(learner);
+	m_environmentSteps = 0;
+
+	// The local view's agent channel reads the live flags, the learner must encode states as the actors saw them
+	auto tileFlags = env.m_tileFlags;
+	ActorEnvironments::clearAgents(env);
+	m_activeActors = numActors;
+
+	Stats stats;
+	std::thread learnerThread(&AsyncDQNTrainer::learn, this, std::ref(learner), std::ref(stats));
+	std::vector<std::thread> actors;
+	for (int i = 0; i < numActors; ++i) {
+		actors.push_back(std::thread(&AsyncDQNTrainer::actor, this, i, maxIterations));
+	}
+	for (auto & thread : actors) {
+		thread.join();
+	}
+	learnerThread.join();
+	env.m_tileFlags = tileFlags;
+
+	m_envs.mergeHeatMaps(env);
+	m_actors.clear();
+	m_envs.clear();
+	m_queues.clear();
+	m_weights.reset();
+
+	stats.environmentSteps = m_environmentSteps.load();
+	stats.episodes = m_envs.getEpisodes();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+/// <summary>
+/// Actor thread, runs episodes in its own environment with its own copy of the latest published network
+/// </summary>
+void AsyncDQNTrainer::actor(int id, int maxIterations)
+{
+	Environment & env = m_envs.at(id);
+	Agent & agent = *m_actors[id];
+	SPSCQueue<Agent::AgentMemoryBatch> & queue = *m_queues[id];
+	std::mt19937 generator(std::random_device{}() + id);
+	auto spawns = env.getSpawnablePoint();
+	std::shared_ptr<const std::vector<float>> weights;
+
+	float episodeEpsilon;
+	while (!spawns.empty() && m_envs.claimEpisode(episodeEpsilon)) {
+		std::shared_ptr<const std::vector<float>> latest = std::atomic_load(&m_weights);
+		if (latest != weights) {
+			weights = latest;
+			agent.importWeights(*weights);
+		}
+
+		std::uniform_int_distribution<int> spawn(0, (int)spawns.size() - 1);
+		State currentState = spawns[spawn(generator)];
+		State previousState = currentState;
+		for (int iter = 0; iter < maxIterations; ++iter) {
+			int action = agent.getActionDQN(env, currentState, previousState, episodeEpsilon);
+			auto stateVals = env.step(action, currentState);
+			Agent::AgentMemoryBatch t;
+			t.state = currentState;
+			t.action = action;
+			t.nextState = std::get<0>(stateVals);
+			t.reward = std::get<1>(stateVals);
+			t.done = std::get<2>(stateVals);
+			while (!queue.tryPush(t)) {
+				std::this_thread::yield();
+			}
+			m_environmentSteps.fetch_add(1, std::memory_order_relaxed);
+			previousState = currentState;
+			currentState = t.nextState;
+			if (t.done)
+				break;
+		}
+	}
+	m_activeActors.fetch_sub(1, std::memory_order_release);
+}
+
+/// <summary>
+/// Learner thread, stores whatever the actors have queued then fits one minibatch, until the actors are done
+/// </summary>
+void AsyncDQNTrainer::learn(Agent & learner, Stats & stats)
+{
+	// A warm up beyond the replay capacity could never be reached
+	int warmup = std::min(m_warmupSteps, learner.getReplayCapacity());
+	while (true) {
+		bool finished = m_activeActors.load(std::memory_order_acquire) == 0;
+		int drained = 0;
+		for (auto & queue : m_queues) {
+			Agent::AgentMemoryBatch memory;
+			while (queue->tryPop(memory)) {
+				learner.replayMemory(memory);
+				drained++;
+			}
+		}
+		if (finished && drained == 0)
+			break;
+		if (learner.getReplaySize() < warmup) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		learner.fitReplayBatch();
+		stats.gradientSteps++;
+		if (stats.gradientSteps % m_targetSyncInterval == 0)
+			learner.updateTargetModel();
+		if (stats.gradientSteps % m_publishInterval == 0)
+			publish(learner);
+	}
+}
+
+/// <summary>
+/// Publish a copy of the learner's online weights for the actors
+/// </summary>
+void AsyncDQNTrainer::publish(Agent & learner)
+{
+	std::atomic_store(&m_weights, std::shared_ptr<const std::vector<float>>(std::make_shared<std::vector<float>>(learner.exportWeights())));
+}
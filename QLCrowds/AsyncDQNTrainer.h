@@ -0,0 +1,54 @@
+#ifndef ASYNCDQNTRAINER_H
+#define ASYNCDQNTRAINER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "Agent.h"
+#include "SPSCQueue.h"
+#include "ActorEnvironments.h"
+
+/// <summary>
+/// Trains one DQN agent with acting and learning overlapped.
+/// Actor threads each step their own copy of the environment with their own copy of the network, pushing
+/// transitions into a lock free queue per actor. A dedicated learner thread moves the queued transitions into
+/// the agent's replay memory and fits minibatches continuously, publishing the online weights every few gradient
+/// steps. Actors pick up the latest published weights at the start of each episode.
+/// The calling thread only starts the threads and waits for them. As the actors see no other agents the
+/// learner is trained on the environment with its agent flags cleared too, they are restored afterwards.
+/// </summary>
+class AsyncDQNTrainer {
+public:
+	struct Stats {
+		long long environmentSteps = 0;
+		long long gradientSteps = 0;
+		int episodes = 0;
+		double seconds = 0;
+	};
+
+	AsyncDQNTrainer();
+	~AsyncDQNTrainer();
+
+	int m_numActors = 4;
+	int m_queueCapacity = 4096;		// Transitions each actor can have in flight before it waits on the learner
+	int m_warmupSteps = 100;			// Memories stored before the learner starts fitting, at most the replay capacity
+	int m_publishInterval = 50;		// Gradient steps between weight snapshots for the actors
+	int m_targetSyncInterval = 100;	// Gradient steps between target network updates
+	float m_minEpsilon = 0.01f;
+
+	Stats run(Agent & learner, Environment & env, int numEpisodes, int maxIterations, float epsilon, float epsilonDecay);
+private:
+	std::shared_ptr<const std::vector<float>> m_weights;
+	std::vector<std::unique_ptr<SPSCQueue<Agent::AgentMemoryBatch>>> m_queues;
+	ActorEnvironments m_envs;
+	std::vector<std::unique_ptr<Agent>> m_actors;
+	std::atomic<int> m_activeActors;
+	std::atomic<long long> m_environmentSteps;
+
+	void actor(int id, int maxIterations);
+	void learn(Agent & learner, Stats & stats);
+	void publish(Agent & learner);
+};
+
+#endif //!ASYNCDQNTRAINER_H
@@ -0,0 +1,340 @@
+#include "Checkpoint.h"
+#include <fstream>
+#include <cstddef>
+#include <string.h>
+
+namespace {
+	/// <summary>
+	/// Bounds checked sequential reads from a section payload
+	/// </summary>
+	class SectionReader {
+	public:
+		SectionReader(const char * data, size_t size) : m_data(data), m_size(size) {}
+
+		template<typename T>
+		bool read(T & value)
+		{
+			if (m_size - m_offset < sizeof(T))
+				return false;
+			memcpy(&value, m_data + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		const char * take(size_t size)
+		{
+			if (m_size - m_offset < size)
+				return nullptr;
+			const char * data = m_data + m_offset;
+			m_offset += size;
+			return data;
+		}
+
+		size_t remaining() const
+		{
+			return m_size - m_offset;
+		}
+	private:
+		const char * m_data;
+		size_t m_size;
+		size_t m_offset = 0;
+	};
+}
+
+/// <summary>
+/// Default checkpoint constructor, empty and ready for writing
+/// </summary>
+Checkpoint::Checkpoint()
+{
+	FileHeader header = { MAGIC, VERSION, 0, 0 };
+	write(&header, sizeof(header));
+}
+
+Checkpoint::~Checkpoint()
+{
+}
+
+/// <summary>
+/// Add a Q table in its stored precision
+/// </summary>
+/// <param name="id">Index of the owning agent or SHARED_ID</param>
+/// <param name="table">The table to store</param>
+void Checkpoint::addQTable(int id, const QTable & table)
+{
+	beginSection(QLCSectionQTable, id);
+	table.serialize(m_buffer);
+	endSection();
+}
+
+/// <summary>
+/// Add the joint action Q values as a count of entries, each its joint state followed by its joint action values
+/// </summary>
+void Checkpoint::addJointQ(const JointQTable & table)
+{
+	beginSection(QLCSectionJointQ, 0);
+	uint32_t entries = table.size();
+	write(&entries, sizeof(entries));
+	for (auto & entry : table) {
+		uint32_t numStates = entry.first.size();
+		write(&numStates, sizeof(numStates));
+		for (auto & state : entry.first) {
+			int32_t coords[2] = { state.first, state.second };
+			write(coords, sizeof(coords));
+		}
+		uint32_t numActions = entry.second.size();
+		write(&numActions, sizeof(numActions));
+		for (auto & action : entry.second) {
+			int32_t actions[2] = { action.first.first, action.first.second };
+			write(actions, sizeof(actions));
+			write(&action.second, sizeof(float));
+		}
+	}
+	endSection();
+}
+
+/// <summary>
+/// Add the weights of a network along with the size of every weight vector so mismatched architectures are rejected
+/// </summary>
+/// <param name="type">QLCSectionModel or QLCSectionTargetModel</param>
+/// <param name="id">Index of the owning agent</param>
+/// <param name="model">The network to store</param>
+void Checkpoint::addModel(QLCCheckpointSection type, int id, mw::Model & model)
+{
+	beginSection(type, id);
+	auto sizes = mw::layout(model);
+	auto values = mw::flatten(model);
+	uint32_t numVectors = sizes.size();
+	write(&numVectors, sizeof(numVectors));
+	write(sizes.data(), sizes.size() * sizeof(uint32_t));
+	write(values.data(), values.size() * sizeof(float));
+	endSection();
+}
+
+/// <summary>
+/// Add the exploration probability of every agent so training resumes where it stopped
+/// </summary>
+void Checkpoint::addExploration(const std::vector<float> & epsilon)
+{
+	beginSection(QLCSectionExploration, 0);
+	uint32_t count = epsilon.size();
+	write(&count, sizeof(count));
+	write(epsilon.data(), epsilon.size() * sizeof(float));
+	endSection();
+}
+
+/// <summary>
+/// Write the checkpoint to disk
+/// </summary>
+/// <param name="path">Path of the file to write</param>
+/// <returns>If the file was written</returns>
+bool Checkpoint::save(const std::string & path)
+{
+	FileHeader header = { MAGIC, VERSION, m_sectionCount, 0 };
+	memcpy(&m_buffer[0], &header, sizeof(header));
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	file.write(m_buffer.data(), m_buffer.size());
+	return (bool)file;
+}
+
+/// <summary>
+/// Map a checkpoint file and index its sections
+/// </summary>
+/// <param name="path">Path of the file to read</param>
+/// <returns>If the file exists, is a checkpoint of this version and every section is in bounds</returns>
+bool Checkpoint::open(const std::string & path)
+{
+	close();
+	if (!m_file.open(path))
+		return false;
+	SectionReader reader(m_file.data(), m_file.size());
+	FileHeader header;
+	if (!reader.read(header) || header.magic != MAGIC || header.version != VERSION) {
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < header.sectionCount; ++i) {
+		Section section;
+		// Checked before padding, a size near the 64 bit limit would round up to 0
+		if (!reader.read(section.header) || section.header.size > reader.remaining()) {
+			close();
+			return false;
+		}
+		size_t padded = (section.header.size + 7) & ~(uint64_t)7;
+		section.data = reader.take(padded);
+		if (!section.data) {
+			close();
+			return false;
+		}
+		m_sections.push_back(section);
+	}
+	return true;
+}
+
+/// <summary>
+/// Unmap the checkpoint file
+/// </summary>
+void Checkpoint::close()
+{
+	m_sections.clear();
+	m_file.close();
+}
+
+/// <summary>
+/// If the opened checkpoint contains a section
+/// </summary>
+bool Checkpoint::hasSection(QLCCheckpointSection type, int id) const
+{
+	return findSection(type, id) != nullptr;
+}
+
+/// <summary>
+/// Load a Q table, the table must already have the dimensions of the stored one
+/// </summary>
+/// <param name="id">Index of the owning agent or SHARED_ID</param>
+/// <param name="table">The table to load into, it takes the stored precision</param>
+/// <returns>If the table was found and loaded</returns>
+bool Checkpoint::loadQTable(int id, QTable & table) const
+{
+	auto section = findSection(QLCSectionQTable, id);
+	if (!section)
+		return false;
+	int32_t dims[3];
+	if (section->header.size < sizeof(dims))
+		return false;
+	memcpy(dims, section->data, sizeof(dims));
+	if (dims[0] != table.getRows() || dims[1] != table.getCols() || dims[2] != table.getActions())
+		return false;
+	return table.deserialize(section->data, section->header.size);
+}
+
+/// <summary>
+/// Load the joint action Q values, stored entries replace existing ones
+/// </summary>
+bool Checkpoint::loadJointQ(JointQTable & table) const
+{
+	auto section = findSection(QLCSectionJointQ, 0);
+	if (!section)
+		return false;
+	SectionReader reader(section->data, section->header.size);
+	uint32_t entries;
+	if (!reader.read(entries))
+		return false;
+	for (uint32_t i = 0; i < entries; ++i) {
+		uint32_t numStates;
+		if (!reader.read(numStates))
+			return false;
+		std::vector<std::pair<int, int>> states;
+		for (uint32_t s = 0; s < numStates; ++s) {
+			int32_t coords[2];
+			if (!reader.read(coords))
+				return false;
+			states.push_back(std::make_pair(coords[0], coords[1]));
+		}
+		uint32_t numActions;
+		if (!reader.read(numActions))
+			return false;
+		auto & values = table[states];
+		for (uint32_t a = 0; a < numActions; ++a) {
+			int32_t actions[2];
+			float value;
+			if (!reader.read(actions) || !reader.read(value))
+				return false;
+			values[std::make_pair(actions[0], actions[1])] = value;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Load the weights of a network with the same architecture as the stored one
+/// </summary>
+/// <param name="type">QLCSectionModel or QLCSectionTargetModel</param>
+/// <param name="id">Index of the owning agent</param>
+/// <param name="model">The built network to load into</param>
+/// <returns>If the weights were found and the architecture matched</returns>
+bool Checkpoint::loadModel(QLCCheckpointSection type, int id, mw::Model & model) const
+{
+	auto section = findSection(type, id);
+	if (!section)
+		return false;
+	SectionReader reader(section->data, section->header.size);
+	uint32_t numVectors;
+	if (!reader.read(numVectors))
+		return false;
+	auto sizes = mw::layout(model);
+	auto stored = reader.take(numVectors * sizeof(uint32_t));
+	if (!stored || numVectors != sizes.size() || memcmp(stored, sizes.data(), numVectors * sizeof(uint32_t)) != 0)
+		return false;
+	size_t count = mw::parameterCount(model);
+	auto values = reader.take(count * sizeof(float));
+	if (!values)
+		return false;
+	// The payload is only 4 byte aligned within the mapping so copy out rather than reading floats in place
+	std::vector<float> weights(count);
+	memcpy(weights.data(), values, count * sizeof(float));
+	return mw::unflatten(model, weights.data(), count);
+}
+
+/// <summary>
+/// Load the exploration probability of every agent
+/// </summary>
+bool Checkpoint::loadExploration(std::vector<float> & epsilon) const
+{
+	auto section = findSection(QLCSectionExploration, 0);
+	if (!section)
+		return false;
+	SectionReader reader(section->data, section->header.size);
+	uint32_t count;
+	if (!reader.read(count))
+		return false;
+	auto values = reader.take(count * sizeof(float));
+	if (!values)
+		return false;
+	epsilon.resize(count);
+	memcpy(epsilon.data(), values, count * sizeof(float));
+	return true;
+}
+
+/// <summary>
+/// Start a section, the size is filled in by endSection
+/// </summary>
+void Checkpoint::beginSection(QLCCheckpointSection type, int id)
+{
+	SectionHeader header = { (uint32_t)type, id, 0 };
+	m_sectionStart = m_buffer.size();
+	write(&header, sizeof(header));
+}
+
+/// <summary>
+/// Finish the current section, patch its size and pad to 8 bytes so the next section header is aligned
+/// </summary>
+void Checkpoint::endSection()
+{
+	uint64_t size = m_buffer.size() - m_sectionStart - sizeof(SectionHeader);
+	memcpy(&m_buffer[m_sectionStart + offsetof(SectionHeader, size)], &size, sizeof(size));
+	m_buffer.resize((m_buffer.size() + 7) & ~(size_t)7, 0);
+	m_sectionCount++;
+}
+
+/// <summary>
+/// Append raw bytes to the checkpoint
+/// </summary>
+void Checkpoint::write(const void * data, size_t size)
+{
+	const char * bytes = static_cast<const char *>(data);
+	m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+/// <summary>
+/// Find a section in the opened checkpoint
+/// </summary>
+const Checkpoint::Section * Checkpoint::findSection(QLCCheckpointSection type, int id) const
+{
+	for (auto & section : m_sections) {
+		if (section.header.type == (uint32_t)type && section.header.id == id)
+			return &section;
+	}
+	return nullptr;
+}
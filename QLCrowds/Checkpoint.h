@@ -0,0 +1,87 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "QTable.h"
+#include "MappedFile.h"
+#include "ModelWeights.h"
+
+typedef std::map<std::vector<std::pair<int, int>>, std::map<std::pair<int, int>, float>> JointQTable;
+
+typedef int QLCCheckpointSection;
+/// <summary>
+/// Kinds of data stored in a checkpoint
+/// </summary>
+enum QLCCheckpointSection_ {
+	QLCSectionQTable = 1,			// Raw Q table storage
+	QLCSectionJointQ = 2,			// Joint action Q values
+	QLCSectionModel = 3,			// Online DQN weights
+	QLCSectionTargetModel = 4,		// Target DQN weights
+	QLCSectionExploration = 5		// Exploration probability of every agent
+};
+
+/// <summary>
+/// Versioned binary checkpoint of learned state.
+/// A file is a header (magic, version, section count) followed by sections, each a type, an id and a byte size
+/// followed by the payload padded to 8 bytes. Ids are agent indices, a Q table shared by a crowd uses id -1.
+/// Checkpoints are built in memory and written in one go, and read back through a memory mapping so table
+/// storage is copied straight out of the mapped pages.
+/// </summary>
+class Checkpoint {
+public:
+	static const uint32_t MAGIC = 0x4B434C51;	// "QLCK"
+	static const uint32_t VERSION = 2;	// 2 added sparse Q table storage
+	static const int SHARED_ID = -1;
+
+	Checkpoint();
+	~Checkpoint();
+
+	// Writing
+	void addQTable(int id, const QTable & table);
+	void addJointQ(const JointQTable & table);
+	void addModel(QLCCheckpointSection type, int id, mw::Model & model);
+	void addExploration(const std::vector<float> & epsilon);
+	bool save(const std::string & path);
+
+	// Reading
+	bool open(const std::string & path);
+	void close();
+	bool hasSection(QLCCheckpointSection type, int id) const;
+	bool loadQTable(int id, QTable & table) const;
+	bool loadJointQ(JointQTable & table) const;
+	bool loadModel(QLCCheckpointSection type, int id, mw::Model & model) const;
+	bool loadExploration(std::vector<float> & epsilon) const;
+private:
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sectionCount;
+		uint32_t reserved;
+	};
+	struct SectionHeader {
+		uint32_t type;
+		int32_t id;
+		uint64_t size;
+	};
+	struct Section {
+		SectionHeader header;
+		const char * data;
+	};
+
+	std::vector<char> m_buffer;
+	size_t m_sectionStart = 0;
+	uint32_t m_sectionCount = 0;
+	void beginSection(QLCCheckpointSection type, int id);
+	void endSection();
+	void write(const void * data, size_t size);
+
+	MappedFile m_file;
+	std::vector<Section> m_sections;
+	const Section * findSection(QLCCheckpointSection type, int id) const;
+};
+
+#endif //!CHECKPOINT_H
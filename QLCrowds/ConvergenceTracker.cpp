@@ -0,0 +1,121 @@
+#include "ConvergenceTracker.h"
+#include <cmath>
+#include <algorithm>
+
+/// <summary>
+/// Default convergence tracker constructor
+/// </summary>
+ConvergenceTracker::ConvergenceTracker()
+{
+}
+
+ConvergenceTracker::~ConvergenceTracker()
+{
+}
+
+/// <summary>
+/// Size the per state records for a grid and clear them
+/// </summary>
+/// <param name="rows">Number of rows in the grid</param>
+/// <param name="cols">Number of columns in the grid</param>
+void ConvergenceTracker::resize(int rows, int cols)
+{
+	m_rows = rows;
+	m_cols = cols;
+	m_greedy.assign(rows * cols, -1);
+	m_maxTD.assign(rows * cols, 0.f);
+	m_touched.clear();
+	m_policyChanged = false;
+	m_episodeMaxTD = 0;
+	m_stableCount = 0;
+}
+
+/// <summary>
+/// Forget everything seen so far, used when the learner is reset
+/// </summary>
+void ConvergenceTracker::reset()
+{
+	resize(m_rows, m_cols);
+}
+
+/// <summary>
+/// Record an update to a state
+/// </summary>
+/// <param name="row">Row of the updated state</param>
+/// <param name="col">Column of the updated state</param>
+/// <param name="greedyAction">The greedy action of the state after the update</param>
+/// <param name="tdError">The TD error that drove the update</param>
+void ConvergenceTracker::observe(int row, int col, int greedyAction, float tdError)
+{
+	int index = row * m_cols + col;
+	if (m_greedy[index] != greedyAction) {
+		m_greedy[index] = greedyAction;
+		m_policyChanged = true;
+	}
+	float error = std::fabs(tdError);
+	if (error > m_maxTD[index]) {
+		if (m_maxTD[index] == 0)
+			m_touched.push_back(index);
+		m_maxTD[index] = error;
+		m_episodeMaxTD = std::max(m_episodeMaxTD, error);
+	}
+}
+
+/// <summary>
+/// Close the current episode and update the stable episode count
+/// </summary>
+/// <returns>If the learner is converged</returns>
+bool ConvergenceTracker::endEpisode()
+{
+	if (!m_policyChanged && m_episodeMaxTD < m_tdThreshold)
+		m_stableCount++;
+	else
+		m_stableCount = 0;
+	for (int index : m_touched) {
+		m_maxTD[index] = 0;
+	}
+	m_touched.clear();
+	m_policyChanged = false;
+	m_episodeMaxTD = 0;
+	return converged();
+}
+
+/// <summary>
+/// If the policy has been stable for the required number of episodes
+/// </summary>
+bool ConvergenceTracker::converged() const
+{
+	return m_stableCount >= m_stableEpisodes;
+}
+
+/// <summary>
+/// Get the last greedy action recorded for a state, -1 if the state was never updated
+/// </summary>
+int ConvergenceTracker::getGreedyAction(int row, int col) const
+{
+	return m_greedy[row * m_cols + col];
+}
+
+/// <summary>
+/// Get the largest absolute TD error of a state in the current episode
+/// </summary>
+float ConvergenceTracker::getMaxTDError(int row, int col) const
+{
+	return m_maxTD[row * m_cols + col];
+}
+
+/// <summary>
+/// Get the largest absolute TD error of any state in the current episode
+/// </summary>
+float ConvergenceTracker::getEpisodeMaxTDError() const
+{
+	return m_episodeMaxTD;
+}
+
+/// <summary>
+/// Get the number of consecutive stable episodes
+/// </summary>
+int ConvergenceTracker::getStableCount() const
+{
+	return m_stableCount;
+}
@@ -0,0 +1,54 @@
+#ifndef CONVERGENCETRACKER_H
+#define CONVERGENCETRACKER_H
+
+#include <vector>
+
+typedef int QLCConvergenceStop;
+/// <summary>
+/// What stops training once learners converge
+/// </summary>
+enum QLCConvergenceStop_ {
+	QLCConvergenceOff = 0,			// Always run every episode
+	QLCConvergencePerAgent = 1,		// Converged agents stop learning and act greedily, the run ends when all have converged
+	QLCConvergenceRun = 2			// Every agent keeps learning until all have converged
+};
+
+/// <summary>
+/// Tracks when a tabular learner has stopped learning.
+/// Every update reports the greedy action of the updated state and the TD error that moved it, a learner is
+/// considered converged once no greedy action changed and every TD error stayed below the threshold for a
+/// number of consecutive episodes.
+/// </summary>
+class ConvergenceTracker {
+public:
+	ConvergenceTracker();
+	~ConvergenceTracker();
+
+	float m_tdThreshold = 0.05f;		// Largest absolute TD error of a stable episode
+	int m_stableEpisodes = 20;			// Consecutive stable episodes before the learner is converged
+
+	void resize(int rows, int cols);
+	void reset();
+
+	void observe(int row, int col, int greedyAction, float tdError);
+	bool endEpisode();
+	bool converged() const;
+
+	int getGreedyAction(int row, int col) const;
+	float getMaxTDError(int row, int col) const;
+	float getEpisodeMaxTDError() const;
+	int getStableCount() const;
+private:
+	int m_rows = 0;
+	int m_cols = 0;
+
+	std::vector<int> m_greedy;			// Last greedy action seen for each state, -1 if never updated
+	std::vector<float> m_maxTD;			// Largest absolute TD error of each state this episode
+	std::vector<int> m_touched;			// States with a non zero TD entry so the episode reset is sparse
+
+	bool m_policyChanged = false;
+	float m_episodeMaxTD = 0;
+	int m_stableCount = 0;
+};
+
+#endif //!CONVERGENCETRACKER_H
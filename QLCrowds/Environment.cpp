@@ -57,7 +57,6 @@ std::tuple<std::pair<int, int>, float, bool> Environment::step(int action, std::
 		state.first + actionCoords[action].first,
 		state.second + actionCoords[action].second);
 
-	auto closestagent = getClosestAgent(state);
 	float reward = R[state.first][state.second][action] - (std::abs(next_state.first - state.first) + std::abs(next_state.second - state.second));
 	bool done = m_tileFlags[next_state.first][next_state.second] & QLCTileGoal;
 
@@ -157,6 +156,26 @@ std::vector<int> Environment::allowedActions(const std::pair<int, int> & state)
 	return allowed;
 }
 
+/// <summary>
+/// Get the actions allowed in a state as a mask, staying still is always allowed
+/// </summary>
+/// <param name="state">The state to check</param>
+/// <returns>Mask of the actions that stay on the grid and out of obstacles</returns>
+ActionMask Environment::allowedActionMask(const std::pair<int, int> & state) const
+{
+	ActionMask mask = 0;
+	for (int a = 0; a < am::NUM_ACTIONS; ++a) {
+		int row = state.first + am::ACTION_COORDS[a].first;
+		int col = state.second + am::ACTION_COORDS[a].second;
+		int inside = (row >= 0) & (row < m_stateDim.first) & (col >= 0) & (col < m_stateDim.second);
+		// Clamp the read so it stays in bounds, an off grid result is discarded by inside
+		int flags = m_tileFlags[std::min(std::max(row, 0), m_stateDim.first - 1)][std::min(std::max(col, 0), m_stateDim.second - 1)];
+		int stay = (row == state.first) & (col == state.second);
+		mask |= (ActionMask)((inside & !(flags & QLCTileObstacle)) | stay) << a;
+	}
+	return mask;
+}
+
 std::pair<int, int>Environment::getClosestAgent(const std::pair<int, int>& state)
 {
 	std::pair<int, int> closestAgentState;
@@ -291,6 +310,7 @@ void Environment::createHeatmapVals()
 void Environment::addObstacle(int row, int col)
 {
 	m_tileFlags[row][col] ^= QLCTileObstacle;
+	m_layoutVersion++;
 }
 
 /// <summary>
@@ -303,6 +323,7 @@ void Environment::addGoal(int row, int col)
 	float rGoal = 100;
 	float rNonGoal = -0.1f;
 	m_tileFlags[row][col] ^= QLCTileGoal;
+	m_layoutVersion++;
 	bool active = m_tileFlags[row][col] & QLCTileGoal;
 	if (active) {
 		m_goals.push_back(std::make_pair(row, col));
@@ -352,6 +373,7 @@ void Environment::resetFlags()
 			col = QLCTileEMPTY;
 		}
 	}
+	m_layoutVersion++;
 }
 
 /// <summary>
@@ -401,6 +423,7 @@ void Environment::init(int x, int y)
 	initFlags();
 	buildRewards();
 	generateGridLines();
+	m_layoutVersion++;
 }
 
 /// <summary>
@@ -470,6 +493,14 @@ std::vector<std::pair<int, int>> Environment::getObstacles()
 	return obstacles;
 }
 
+/// <summary>
+/// Counter bumped whenever goals or obstacles change, lets cached copies of the layout know they are stale
+/// </summary>
+unsigned int Environment::getLayoutVersion() const
+{
+	return m_layoutVersion;
+}
+
 std::pair<int, int> Environment::getStateDim()
 {
 	return m_stateDim;
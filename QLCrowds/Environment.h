@@ -6,6 +6,8 @@
 #include <tuple>
 #include <SDL.h>
 
+#include "ActionMask.h"
+
 typedef int QLCTileFlags;
  /// <summary>
 /// Flags for representing a tiles information and varying states
@@ -55,6 +57,7 @@ public:
 	std::tuple<std::vector<State>, float, bool> stepJAQL(std::vector<int> & actions, std::vector<State> & states);
 	void reset();
 	std::vector<int> allowedActions(const std::pair<int, int> & state);
+	ActionMask allowedActionMask(const std::pair<int, int> & state) const;
 	std::pair<int, int> getClosestAgent(const std::pair<int, int> & state);
 
 	// display functions
@@ -77,6 +80,7 @@ public:
 	std::vector<std::pair<int, int>> getObstacles();
 
 	// Getters
+	unsigned int getLayoutVersion() const;
 	std::pair<int, int> getStateDim();
 	std::pair<int, int> getActionDim();
 protected:
@@ -87,6 +91,7 @@ protected:
 	std::vector<Line> m_gridLines;
 	void buildRewards();
 	std::vector<std::pair<int, int>> m_goals;
+	unsigned int m_layoutVersion = 0;
 	struct Line {
 		int x1;
 		int x2;
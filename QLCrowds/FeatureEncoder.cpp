@@ -0,0 +1,89 @@
+#include "FeatureEncoder.h"
+
+/// <summary>
+/// Default feature encoder constructor, nothing is cached until the first update
+/// </summary>
+FeatureEncoder::FeatureEncoder()
+{
+}
+
+FeatureEncoder::~FeatureEncoder()
+{
+}
+
+/// <summary>
+/// Gather the goals and obstacles again if the environment layout changed since the last update
+/// </summary>
+/// <param name="env">The environment the states belong to</param>
+/// <returns>True if the cached layout was rebuilt</returns>
+bool FeatureEncoder::update(Environment & env)
+{
+	if (m_valid && m_env == &env && m_layoutVersion == env.getLayoutVersion())
+		return false;
+	m_env = &env;
+	m_layoutVersion = env.getLayoutVersion();
+	m_valid = true;
+	if (m_mode == QLCObservationLocalView) {
+		// Pad the static tiles by the view radius, off grid cells count as obstacles
+		auto stateDim = env.getStateDim();
+		m_paddedCols = stateDim.second + 2 * m_viewRadius;
+		m_padded.assign((stateDim.first + 2 * m_viewRadius) * m_paddedCols, (uint8_t)QLCTileObstacle);
+		for (int row = 0; row < stateDim.first; ++row) {
+			for (int col = 0; col < stateDim.second; ++col) {
+				int flags = env.m_tileFlags[row][col] & (QLCTileObstacle | QLCTileGoal);
+				m_padded[(row + m_viewRadius) * m_paddedCols + col + m_viewRadius] = (uint8_t)flags;
+			}
+		}
+		return true;
+	}
+	auto & goals = env.getGoals();
+	auto obstacles = env.getObstacles();
+	m_points.clear();
+	m_points.reserve(goals.size() + obstacles.size());
+	m_points.insert(m_points.end(), goals.begin(), goals.end());
+	m_points.insert(m_points.end(), obstacles.begin(), obstacles.end());
+	return true;
+}
+
+/// <summary>
+/// Number of features of an encoded state
+/// </summary>
+int FeatureEncoder::size() const
+{
+	if (m_mode == QLCObservationLocalView)
+		return LOCAL_VIEW_CHANNELS * getViewSize() * getViewSize();
+	return 2 + 2 * (int)m_points.size();
+}
+
+/// <summary>
+/// Choose the observation, the cache is rebuilt on the next update
+/// </summary>
+/// <param name="mode">The observation to encode</param>
+/// <param name="viewRadius">Cells seen in each direction by the local view</param>
+void FeatureEncoder::setMode(QLCObservation mode, int viewRadius)
+{
+	m_mode = mode;
+	m_viewRadius = viewRadius > 0 ? viewRadius : 1;
+	m_valid = false;
+}
+
+QLCObservation FeatureEncoder::getMode() const
+{
+	return m_mode;
+}
+
+/// <summary>
+/// Cells the local view sees in each direction from the state
+/// </summary>
+int FeatureEncoder::getViewRadius() const
+{
+	return m_viewRadius;
+}
+
+/// <summary>
+/// Width and height of the local view
+/// </summary>
+int FeatureEncoder::getViewSize() const
+{
+	return 2 * m_viewRadius + 1;
+}
@@ -0,0 +1,99 @@
+#ifndef FEATUREENCODER_H
+#define FEATUREENCODER_H
+
+#include <vector>
+#include <stdint.h>
+#include "Environment.h"
+
+typedef int QLCObservation;
+/// <summary>
+/// What the DQN sees of a state
+/// </summary>
+enum QLCObservation_ {
+	QLCObservationOffsets = 0,		// Position plus the offset to every goal and obstacle, grows with the map contents
+	QLCObservationLocalView = 1		// Fixed size egocentric image of obstacles, goals and agents around the state
+};
+
+/// <summary>
+/// Encodes a state as the DQN input.
+/// Offsets are the state's position followed by its offset to every goal and then every obstacle.
+/// The local view is a square of (2 * radius + 1) cells centred on the state with one channel each for obstacles,
+/// goals and other agents, laid out channel by channel and row by row as tiny_dnn's convolutions expect.
+/// Cells off the grid read as obstacles. Its size never depends on the map, so one network works on any map.
+/// The static layout is cached and only gathered again when the environment's layout version changes, so
+/// encoding a state never scans the grid. The agent channel reads the live tile flags, for a replayed memory it
+/// shows where agents are now rather than when the memory was made.
+/// </summary>
+class FeatureEncoder {
+public:
+	static const int LOCAL_VIEW_CHANNELS = 3;
+
+	FeatureEncoder();
+	~FeatureEncoder();
+
+	void setMode(QLCObservation mode, int viewRadius = 4);
+	QLCObservation getMode() const;
+	int getViewRadius() const;
+	int getViewSize() const;
+
+	bool update(Environment & env);
+	int size() const;
+
+	/// <summary>
+	/// Write the features of a state into out, which must hold size() values
+	/// </summary>
+	template <typename T>
+	void encode(const State & state, T * out) const
+	{
+		if (m_mode == QLCObservationLocalView) {
+			encodeLocalView(state, out);
+			return;
+		}
+		*out++ = (T)state.first;
+		*out++ = (T)state.second;
+		for (auto & point : m_points) {
+			*out++ = (T)(state.first - point.first);
+			*out++ = (T)(state.second - point.second);
+		}
+	}
+private:
+	QLCObservation m_mode = QLCObservationOffsets;
+	int m_viewRadius = 4;
+
+	std::vector<State> m_points;	// Goals followed by obstacles
+	unsigned int m_layoutVersion = 0;
+	bool m_valid = false;
+
+	// Local view, the static tiles of the grid padded by the view radius so a window never leaves it
+	const Environment * m_env = nullptr;
+	std::vector<uint8_t> m_padded;
+	int m_paddedCols = 0;
+
+	template <typename T>
+	void encodeLocalView(const State & state, T * out) const
+	{
+		int view = getViewSize();
+		int area = view * view;
+		T * obstacles = out;
+		T * goals = out + area;
+		T * agents = out + 2 * area;
+		int rows = (int)m_env->m_tileFlags.size();
+		for (int dy = 0; dy < view; ++dy) {
+			// Padded coordinates of the window row, the state sits at the centre
+			const uint8_t * tiles = &m_padded[(state.first + dy) * m_paddedCols + state.second];
+			int row = state.first + dy - m_viewRadius;
+			for (int dx = 0; dx < view; ++dx) {
+				int cell = dy * view + dx;
+				obstacles[cell] = (T)(tiles[dx] & QLCTileObstacle ? 1 : 0);
+				goals[cell] = (T)(tiles[dx] & QLCTileGoal ? 1 : 0);
+				int col = state.second + dx - m_viewRadius;
+				bool inside = row >= 0 && row < rows && col >= 0 && col < (int)m_env->m_tileFlags[row].size();
+				agents[cell] = (T)(inside && (m_env->m_tileFlags[row][col] & QLCContainsAgent) ? 1 : 0);
+			}
+		}
+		// The centre is the agent itself
+		agents[m_viewRadius * view + m_viewRadius] = 0;
+	}
+};
+
+#endif //!FEATUREENCODER_H
@@ -46,14 +46,16 @@ Game::Game()
 
 	// Actual code init
 	mapUI();
+	m_pool.loadTexture("Assets/agent.png", m_renderer);
+	m_pool.setSize(env.cellW, env.cellH);
 
-	m_agents.clear();
+	m_pool.clear();
 	m_agentDone.clear();
 	m_agentLerping.clear();
 	m_agentIterations.clear();
 	m_lerpPercentages.clear();
 	for (int i = 0; i < m_numAgents; ++i) {
-		m_agents.push_back(new Agent(env, m_renderer));
+		addAgent();
 		m_lerpPercentages.push_back(0);
 		m_agentDone.push_back(false);
 		m_agentLerping.push_back(false);
@@ -83,9 +85,8 @@ void Game::update(float deltaTime)
 	//std::cout << "				Update" << std::endl;
 	if (m_simulationStarted) {
 		if (currentEpisode < m_episodeData.size()) {
-			for (int i = 0; i < m_agents.size(); ++i) {
+			for (int i = 0; i < m_pool.size(); ++i) {
 				if (!m_agentDone.at(i)) {
-					auto & agent = m_agents.at(i);
 					auto & episode = m_episodeData.at(currentEpisode).at(i);
 					m_agentLerping.at(i) = true;
 					if (m_agentIterations.at(i) < episode.size()) {
@@ -104,7 +105,7 @@ void Game::update(float deltaTime)
 						int currentH = h * state.first;
 						int nextW = w * nextState.second;
 						int nextH = h * nextState.first;
-						agent->setPosition(mu::lerp(currentW, nextW, m_lerpPercentages.at(i)), mu::lerp(currentH, nextH, m_lerpPercentages.at(i)));
+						m_pool.setPosition(i, mu::lerp(currentW, nextW, m_lerpPercentages.at(i)), mu::lerp(currentH, nextH, m_lerpPercentages.at(i)));
 						if (!m_agentLerping.at(i)) {
 							m_agentIterations.at(i) += 1;
 							m_lerpPercentages.at(i) = 0.0f;
@@ -112,9 +113,9 @@ void Game::update(float deltaTime)
 							if ( m_agentIterations.at(i) < episode.size())
 								data = episode.at(m_agentIterations.at(i));
 							auto actionPair = std::make_pair(data.nextState.first - data.state.first, data.nextState.second - data.state.second);
-							for (int i = 0; i < env.action_dict.size(); ++i) {
-								if (actionPair.first == env.actionCoords[i].first && actionPair.second == env.actionCoords[i].second) {
-									agent->setOrientation(i);
+							for (int a = 0; a < env.action_dict.size(); ++a) {
+								if (actionPair.first == env.actionCoords[a].first && actionPair.second == env.actionCoords[a].second) {
+									m_pool.setOrientation(i, a);
 								}
 							}
 						}
@@ -122,7 +123,7 @@ void Game::update(float deltaTime)
 					else {
 						m_agentDone.at(i) = true;
 						if (!(std::find(m_agentDone.begin(), m_agentDone.end(), false) != m_agentDone.end())) {
-							for (int j = 0; j < m_agents.size(); ++j) {
+							for (int j = 0; j < m_pool.size(); ++j) {
 								m_agentIterations.at(j) = 0;
 								m_lerpPercentages.at(j) = 0;
 								m_agentLerping.at(j) = false;
@@ -148,9 +149,9 @@ void Game::render()
 	SDL_RenderClear(m_renderer);
 	SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
 	env.render(*m_renderer);
-	for (auto agent : m_agents) {
-		agent->render(*m_renderer);
-	}
+	if (m_showPolicy)
+		renderPolicy();
+	m_pool.render(*m_renderer);
 	SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
 	renderUI();
 	SDL_RenderPresent(m_renderer);
@@ -230,6 +231,9 @@ void Game::runAlgorithm()
 	if (!m_algoStarted) {
 		float currentTime = SDL_GetTicks() / 1000.0f;
 		float timeDif = 0;
+		// A DQN or JAQL run replaced the crowd, its learners do not use the shared table
+		if (m_sharedPolicy && !m_sharedTable)
+			rebuildAgents();
 		m_agentDone.clear();
 		m_agentLerping.clear();
 		m_agentIterations.clear();
@@ -248,101 +252,212 @@ void Game::runAlgorithm()
 		m_episodeData.clear();
 		env.clearHeatMap();
 
-		for (auto & agent : m_agents) {
-			if (current_item == "Q Learning" || current_item == "RBM") {
+		bool optimal = current_item == "Optimal";
+		bool tabular = current_item == "Q Learning" || current_item == "Q(Lambda)" || current_item == "SARSA(Lambda)" || optimal;
+		if (m_sharedTable) {
+			auto stateDim = env.getStateDim();
+			m_sharedTable->setPrecision(m_qPrecision);
+			m_sharedTable->setStorage(m_qStorage);
+			m_sharedTable->resize(stateDim.first, stateDim.second, env.getActionDim().first);
+		}
+		for (auto & agent : m_pool.m_learners) {
+			if (tabular || current_item == "RBM") {
+				agent->Q.setPrecision(m_qPrecision);
+				if (!agent->sharesTable())
+					agent->Q.setStorage(m_qStorage);
 				agent->resizeQTable();
 			}
+			agent->m_convergence.m_stableEpisodes = m_stableEpisodes;
+			agent->m_convergence.m_tdThreshold = m_tdThreshold;
+		}
+		std::cout << "Q table memory " << (m_sharedPolicy ? "shared by the crowd: " : "per agent: ") << m_pool.at(0)->Q.memoryUsage() << " bytes" << std::endl;
+
+		// Solve the exact values to compare the learned tables against and optionally start from them
+		if (tabular) {
+			m_valueIteration.m_gamma = m_pool.at(0)->m_gamma;
+			int sweeps = m_valueIteration.solve(env);
+			std::cout << "Value iteration converged after " << sweeps << " sweeps" << std::endl;
+			if (optimal || m_warmStart) {
+				if (m_sharedTable)
+					m_valueIteration.warmStart(*m_sharedTable);
+				for (auto & agent : m_pool.m_learners) {
+					if (!agent->sharesTable())
+						m_valueIteration.warmStart(agent->Q);
+				}
+				if (optimal)
+					std::fill(m_pool.m_epsilon.begin(), m_pool.m_epsilon.end(), 0.f);
+			}
+		}
+
+		// Continue from saved tables, they load in their saved precision so convert to the selected one
+		if (m_resumeFromCheckpoint && !optimal && loadCheckpoint(m_checkpointPath)) {
+			if (m_sharedTable) {
+				m_sharedTable->setPrecision(m_qPrecision);
+				m_sharedTable->setStorage(m_qStorage);
+			}
+			for (auto & agent : m_pool.m_learners) {
+				agent->Q.setPrecision(m_qPrecision);
+				if (!agent->sharesTable())
+					agent->Q.setStorage(m_qStorage);
+			}
 		}
 
-		for (int i = 0; i < numEpisodes; ++i) {
+		// With several actors every table is trained by its own actor learner, the episodes below then only
+		// run the learned greedy policy once for playback
+		bool actors = m_numActors > 1 && current_item == "Q Learning";
+		int episodes = numEpisodes;
+		if (actors) {
+			ActorLearner actorLearner;
+			actorLearner.m_numActors = m_numActors;
+			for (int i = 0; i < (int)m_pool.m_learners.size(); ++i) {
+				auto agent = m_pool.m_learners[i];
+				auto stats = actorLearner.run(*agent, env, numEpisodes, maxIterations, m_pool.m_epsilon[i], m_pool.m_epsilonDecay[i]);
+				std::cout << "Agent " << i << " trained by " << m_numActors << " actors: " << stats.updates << " updates over " << stats.episodes << " episodes in " << stats.seconds << "s, " << stats.updatesPerSecond << " updates/s" << std::endl;
+			}
+			episodes = 1;
+		}
+
+		bool converged = false;
+		for (int i = 0; i < episodes; ++i) {
 			std::cout << "Episode: " << i << std::endl;
 			std::cout << "=================================================" << std::endl;
+			// A shared policy crowd only keeps the final episode for playback to bound memory
+			bool recordEpisode = !m_sharedPolicy || i == episodes - 1 || converged;
 			std::vector<std::vector<EpisodeVals>> episodeData;
-			episodeData.resize(m_agents.size());
+			episodeData.resize(m_pool.size());
 			std::vector<AgentTrainingValues> agentVals;
-			for (int i = 0; i < m_agents.size(); ++i) {
-				auto & agent = m_agents.at(i);
-				agent->m_done = false;
-				auto states = env.getSpawnablePoint();
+			auto states = env.getSpawnablePoint();
+			m_pool.setAllDone(false);
+			for (int i = 0; i < m_pool.size(); ++i) {
 				std::pair<int, int> state = states.at(std::rand() % states.size());
-				agent->m_previousState = state;
-				agent->m_currentState = state;
+				m_pool.m_previousState[i] = state;
+				m_pool.m_currentState[i] = state;
+				m_pool.resetEpisode(i);
 				agentVals.push_back(AgentTrainingValues(env));
 			}
 			if (m_multiThreaded) {
 				m_threads.clear();
 				m_threads.resize(m_numAgents);
-				for (int i = 0; i < m_agents.size(); ++i) {
-					m_threads.push_back(agentSim(m_agents.at(i), &agentVals, i));
+				for (int i = 0; i < m_pool.size(); ++i) {
+					m_threads.push_back(agentSim(i, &agentVals));
 				}
 			}
 			while (true) {
 				if (!m_multiThreaded) {
-					int currentAgent = 0;
-					for (auto agent : m_agents) {
-						if (!agent->m_done) {
+					for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
+						if (!m_pool.m_done[currentAgent]) {
+							auto agent = m_pool.m_agents[currentAgent];
+							auto & currentState = m_pool.m_currentState[currentAgent];
+							auto & previousState = m_pool.m_previousState[currentAgent];
+							auto & random = m_pool.m_random[currentAgent];
+							auto & nextAction = m_pool.m_nextAction[currentAgent];
+							auto & traces = m_pool.m_traces[currentAgent];
+							// Converged agents stop learning and follow their greedy policy
+							bool frozen = actors || (m_convergenceStop == QLCConvergencePerAgent && agent->m_convergence.converged());
+							float epsilon = frozen ? 0.f : m_pool.m_epsilon[currentAgent];
 							int action;
 							// Get action from policy
-							if (current_item == "Q Learning")
-								action = agent->getAction(env);
+							if (current_item == "Q Learning" || optimal)
+								action = agent->getAction(env, currentState, previousState, epsilon, random);
+							else if (current_item == "Q(Lambda)") {
+								bool greedy = true;
+								action = agent->getAction(env, currentState, previousState, epsilon, random, &greedy);
+								// Watkins Q(lambda) cuts the traces once the agent explores
+								if (!greedy)
+									traces.clear();
+							}
+							else if (current_item == "SARSA(Lambda)")
+								action = nextAction >= 0 ? nextAction : agent->getAction(env, currentState, previousState, epsilon, random);
 							else if (current_item == "RBM")
-								action = agent->getActionRBMBased(env);
+								action = agent->getActionRBMBased(env, currentState);
 							else if (current_item == "MultiRBM")
-								action = agent->getMultiAgentActionRBM(env, agentVals.at(currentAgent).iter_episode, maxIterations);
+								action = agent->getMultiAgentActionRBM(env, currentState, previousState, agentVals.at(currentAgent).iter_episode, maxIterations);
 
 							// Take one step in the environment
-							auto state_vals = env.step(action, agent->m_currentState);
+							auto state_vals = env.step(action, currentState);
 							auto state_next = std::get<0>(state_vals);
 							auto reward = std::get<1>(state_vals);
 							if (reward == -10) {
 								agentVals.at(currentAgent).m_numCollisions++;
 							}
 							bool done = std::get<2>(state_vals);
-							agent->m_previousState = agent->m_currentState;
+							previousState = currentState;
+							currentState = state_next;
 
 							// Train the agent to determine q values
-							agent->train(std::make_tuple(agent->m_currentState, action, state_next, reward, done));
-							agent->m_currentState = state_next;
-							env.setAgentFlags(agent->m_previousState, agent->m_currentState);
+							auto transition = std::make_tuple(previousState, action, state_next, reward, done);
+							bool learn = !optimal && !frozen;
+							if (current_item == "Q(Lambda)") {
+								if (learn)
+									agent->trainLambda(transition, traces);
+							}
+							else if (current_item == "SARSA(Lambda)") {
+								// The on policy backup needs the action the agent will take from the next state
+								nextAction = done ? -1 : agent->getAction(env, currentState, previousState, epsilon, random);
+								if (learn)
+									agent->trainLambda(transition, traces, nextAction);
+							}
+							else if (learn) {
+								agent->train(transition);
+							}
+							env.setAgentFlags(previousState, currentState);
 
 							// Log values for the simulation
-							EpisodeVals vals;
-							vals.action = action;
-							vals.state = agent->m_previousState;
-							vals.nextState = state_next;
-							episodeData.at(currentAgent).push_back(vals);
+							if (recordEpisode) {
+								EpisodeVals vals;
+								vals.action = action;
+								vals.state = previousState;
+								vals.nextState = state_next;
+								episodeData.at(currentAgent).push_back(vals);
+							}
 							
 							agentVals.at(currentAgent).iter_episode += 1;
 							agentVals.at(currentAgent).reward_episode += reward;
 							agentVals.at(currentAgent).state = state_next;
 							if (agentVals.at(currentAgent).iter_episode >= maxIterations || done)
-								agent->m_done = true;
+								m_pool.m_done[currentAgent] = true;
 						}
-						currentAgent++;
 					}
 				}
 
 				// Only finish when all agents are finished
-				auto pred = [](const Agent *a) {
-					return !a->m_done;
-				};
-				if (!(std::find_if(m_agents.begin(), m_agents.end(), pred) != m_agents.end()))
+				if (m_pool.allDone())
 					break;
 			}
-			for (auto agent : m_agents) {
-				agent->m_epsilon = std::fmax(agent->m_epsilon * agent->m_epsilonDecay, 0.01);
+			if (!optimal && !actors) {
+				m_pool.decayEpsilon(0.01f);
+			}
+			int convergedAgents = 0;
+			if (!optimal && !actors && m_convergenceStop != QLCConvergenceOff) {
+				for (auto agent : m_pool.m_learners) {
+					if (agent->m_convergence.endEpisode())
+						convergedAgents++;
+				}
 			}
 
-			int currentAgent = 0;
-			for (auto agent : m_agents) {
-				std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << agent->m_epsilon << " iter: " << agentVals.at(currentAgent).iter_episode << " Rew: " << agentVals.at(currentAgent).reward_episode << " Num Cols: " << agentVals.at(currentAgent).m_numCollisions << std::endl;
-				currentAgent++;
+			if (m_sharedPolicy) {
+				// One summary line for the whole crowd
+				float iterSum = 0;
+				float rewardSum = 0;
+				int collisions = 0;
+				for (auto & vals : agentVals) {
+					iterSum += vals.iter_episode;
+					rewardSum += vals.reward_episode;
+					collisions += vals.m_numCollisions;
+				}
+				std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << m_pool.m_epsilon[0] << " Avg iter: " << iterSum / agentVals.size() << " Avg Rew: " << rewardSum / agentVals.size() << " Num Cols: " << collisions << std::endl;
+			}
+			else {
+				for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
+					std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << m_pool.m_epsilon[currentAgent] << " iter: " << agentVals.at(currentAgent).iter_episode << " Rew: " << agentVals.at(currentAgent).reward_episode << " Num Cols: " << agentVals.at(currentAgent).m_numCollisions << std::endl;
+				}
 			}
 			if (!m_multiThreaded) {
-				for (int i = 0; i < m_agents.size(); ++i) {
+				for (int i = 0; i < m_pool.size(); ++i) {
 					plotPoints.at(i).push_back(agentVals.at(i).reward_episode);
 				}
-				m_episodeData.push_back(episodeData);
+				if (recordEpisode)
+					m_episodeData.push_back(episodeData);
 			} 
 			else {
 				for (auto & thread : m_threads) {
@@ -350,12 +465,25 @@ void Game::runAlgorithm()
 						thread.join();
 				}
 			}
+
+			// Stop early once every learner has converged, a shared crowd first runs one more episode to record it
+			if (converged)
+				break;
+			if (convergedAgents > 0 && convergedAgents == (int)m_pool.m_learners.size()) {
+				std::cout << "All agents converged after " << i + 1 << " episodes" << std::endl;
+				converged = true;
+				if (!m_sharedPolicy)
+					break;
+			}
 		}
 
 		// Display the final policy
-		for (auto agent : m_agents) {
+		for (auto agent : m_pool.m_learners) {
 			std::cout << "Agent: " << std::endl;
 			agent->displayGreedyPolicy(env);
+			if (tabular)
+				std::cout << "Sub optimal greedy actions: " << m_valueIteration.policyMismatches(agent->Q) << std::endl;
+			std::cout << "Q table stores " << agent->Q.getStoredStates() << " /" << agent->Q.getRows() * agent->Q.getCols() << " states in " << agent->Q.memoryUsage() << " bytes" << std::endl;
 		}
 		env.createHeatmapVals();
 		m_algoStarted = false;
@@ -398,9 +526,10 @@ void Game::stopSimulation()
 			thread.join();
 	}
 	m_threads.clear();
-	for (auto agent : m_agents) {
+	for (auto agent : m_pool.m_learners) {
 		agent->reset();
 	}
+	m_pool.resetExploration();
 	m_episodeData.clear();
 	disableInputs = false;
 }
@@ -426,9 +555,43 @@ void Game::resetAlgorithm()
 	m_algoStarted = false;
 	m_algoFinished = false;
 	env.reset();
-	for (auto agent : m_agents) {
+	if (m_sharedTable)
+		m_sharedTable->clear();
+	for (auto agent : m_pool.m_learners) {
 		agent->reset();
 	}
+	m_pool.resetExploration();
+}
+
+/// <summary>
+/// Draw the greedy action of the selected agent in every free cell, a line towards the move or a dot for staying still
+/// </summary>
+void Game::renderPolicy()
+{
+	if (m_pool.size() == 0)
+		return;
+	auto & table = m_pool.at(std::min(agentSelected, m_pool.size() - 1))->Q;
+	auto stateDim = env.getStateDim();
+	if (table.getRows() != stateDim.first || table.getCols() != stateDim.second)
+		return;
+	int length = std::min(env.cellW, env.cellH) / 3;
+	SDL_SetRenderDrawColor(m_renderer, 255, 255, 255, 255);
+	for (int row = 0; row < stateDim.first; ++row) {
+		for (int col = 0; col < stateDim.second; ++col) {
+			if (env.m_tileFlags[row][col] & (QLCTileGoal | QLCTileObstacle))
+				continue;
+			auto & dir = env.actionCoords[table.greedyAction(row, col)];
+			int x = env.gridPosX + col * env.cellW + env.cellW / 2;
+			int y = env.gridPosY + row * env.cellH + env.cellH / 2;
+			if (dir.first == 0 && dir.second == 0) {
+				SDL_Rect dot = { x - 1, y - 1, 3, 3 };
+				SDL_RenderFillRect(m_renderer, &dot);
+			}
+			else {
+				SDL_RenderDrawLine(m_renderer, x, y, x + dir.second * length, y + dir.first * length);
+			}
+		}
+	}
 }
 
 /// <summary>
@@ -447,21 +610,21 @@ void Game::renderUI()
 			ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
 			ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
 		}
-		if (ImGui::DragInt("Num Agents", &m_numAgents, 1, 1, 100)) {
+		if (ImGui::Checkbox("Shared Policy", &m_sharedPolicy)) {
+			rebuildAgents();
+		}
+		if (ImGui::DragInt("Num Agents", &m_numAgents, 1, 1, m_sharedPolicy ? m_maxSharedAgents : m_maxAgents)) {
 			std::cout << "Creating agents" << std::endl;
-			if (m_numAgents > m_agents.size()) {
-				int diff = m_numAgents - m_agents.size();
+			if (m_numAgents > m_pool.size()) {
+				int diff = m_numAgents - m_pool.size();
 				for (int i = 0; i < diff; ++i) {
-					m_agents.push_back(new Agent(env, m_renderer));
+					addAgent();
 				}
 			}
-			else if (m_numAgents < m_agents.size()) {
-				int diff = m_agents.size() - m_numAgents;
+			else if (m_numAgents < m_pool.size()) {
+				int diff = m_pool.size() - m_numAgents;
 				for (int i = 0; i < diff; ++i) {
-					auto back = m_agents.back();
-					delete back;
-					back = nullptr;
-					m_agents.pop_back();
+					m_pool.removeBack();
 				}
 			}
 		}
@@ -471,9 +634,7 @@ void Game::renderUI()
 		if (ImGui::Button("Generate Env")) {
 			mapUI();
 			env.init(env.xSize, env.ySize);
-			for (auto & agent : m_agents) {
-				agent->setSize(env.cellW, env.cellH);
-			}
+			m_pool.setSize(env.cellW, env.cellH);
 			auto stateDim = env.getStateDim();
 			minIterations = stateDim.first + stateDim.second - 2;
 			if (maxIterations < minIterations)
@@ -487,15 +648,36 @@ void Game::renderUI()
 		ImGui::InputInt("Num Episodes: ", &numEpisodes, 1, 100, ImGuiWindowFlags_NoMove);
 		ImGui::InputInt("Num Iterations: ", &maxIterations, 1, 100, ImGuiWindowFlags_NoMove);
 		ImGui::SliderFloat("Lerp Percent", &lerpPercent, 0, 1.f, "%.3f");
+		ImGui::Checkbox("Warm Start From Value Iteration", &m_warmStart);
+		ImGui::Combo("Q Precision", &m_qPrecision, "FP32\0FP16\0Int8\0");
+		ImGui::Combo("Q Storage", &m_qStorage, "Dense\0Sparse\0");
+		ImGui::Combo("Stop When Converged", &m_convergenceStop, "Off\0Per Agent\0Whole Run\0");
+		ImGui::InputInt("Stable Episodes: ", &m_stableEpisodes, 1, 10);
+		ImGui::SliderFloat("TD Threshold", &m_tdThreshold, 0, 1.f, "%.3f");
+		ImGui::SliderInt("Q Learning Actors", &m_numActors, 1, 16);
+		ImGui::InputInt("Replay Capacity: ", &m_replayCapacity, 100, 1000);
+		ImGui::InputInt("Replay Seed: ", &m_replaySeed, 1, 10);
+		ImGui::Checkbox("Replay With Replacement", &m_replayWithReplacement);
+		ImGui::Checkbox("Prioritized Replay", &m_prioritizedReplay);
+		ImGui::SliderFloat("Priority Alpha", &m_priorityAlpha, 0, 1.f, "%.2f");
+		ImGui::SliderFloat("Priority Beta", &m_priorityBeta, 0, 1.f, "%.2f");
+		ImGui::InputInt("Warm Up Steps: ", &m_warmupSteps, 10, 100);
+		ImGui::SliderFloat("Gradient Steps Per Step", &m_gradientStepsPerStep, 0, 4.f, "%.3f");
+		ImGui::Combo("DQN Observation", &m_observation, "Offsets\0Local View\0");
+		ImGui::SliderInt("View Radius", &m_viewRadius, 2, 8);
+		ImGui::Checkbox("Fused DQN Kernel", &m_fusedKernel);
+		ImGui::SliderFloat("Target Update Tau", &m_targetTau, 0.001f, 1.f, "%.3f");
+		ImGui::SliderInt("Async DQN Actors", &m_dqnActors, 0, 16);
+		ImGui::InputInt("DQN Batch Size: ", &m_dqnBatchSize, 16, 128);
+		ImGui::SliderInt("Gradient Threads", &m_gradientThreads, 1, 16);
 		if (!ableToRunAlgo) {
 				ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
 				ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
 		}
 		if (ImGui::Button("Simulation")) {
-			if (current_item == "Q Learning" || current_item == "RBM" || current_item == "MultiRBM") {
-				for (auto & agent : m_agents) {
-					agent->setSize(env.cellW, env.cellH);
-				}
+			if (current_item == "Q Learning" || current_item == "Q(Lambda)" || current_item == "SARSA(Lambda)"
+				|| current_item == "Optimal" || current_item == "RBM" || current_item == "MultiRBM") {
+				m_pool.setSize(env.cellW, env.cellH);
 				runAlgorithm();
 				startSimulation();
 			}
@@ -509,6 +691,16 @@ void Game::renderUI()
 		if (ImGui::Button("Stop Simultation")) {
 			stopSimulation();
 		}
+		ImGui::InputText("Checkpoint", m_checkpointPath, IM_ARRAYSIZE(m_checkpointPath));
+		ImGui::Checkbox("Resume From Checkpoint", &m_resumeFromCheckpoint);
+		if (ImGui::Button("Save Checkpoint")) {
+			saveCheckpoint(m_checkpointPath);
+		}
+		ImGui::InputText("Policy", m_policyPath, IM_ARRAYSIZE(m_policyPath));
+		ImGui::Checkbox("Quantize Policy (int8)", &m_quantizePolicy);
+		if (ImGui::Button("Export Policy")) {
+			exportPolicy(m_policyPath);
+		}
 		if (!ableToRunAlgo) {
 			ImGui::PopItemFlag();
 			ImGui::PopStyleVar();
@@ -541,21 +733,34 @@ void Game::renderUI()
 			ImGui::EndCombo();
 		}
 		ImGui::Separator();
-		if (ImGui::TreeNode("Agents")) {
+		if (m_sharedPolicy && ImGui::TreeNode("Crowd")) {
+			// One set of controls for the whole crowd, every agent learns with the same learner
+			auto learner = m_pool.at(0);
+			ImGui::SliderFloat("Learning Rate:", &learner->m_beta, 0, 1.f, "%.3f");
+			ImGui::SliderFloat("Lambda:", &learner->m_lambda, 0, 1.f, "%.3f");
+			ImGui::SliderFloat("Trace Cutoff:", &learner->m_traceCutoff, 0, 0.5f, "%.3f");
+			ImGui::TreePop();
+		}
+		else if (!m_sharedPolicy && ImGui::TreeNode("Agents")) {
 			int currentAgent = 0;
-			for (auto & agent : m_agents) {
+			for (auto & agent : m_pool.m_learners) {
 				if (ImGui::TreeNode((void*)(intptr_t)currentAgent, "Agent %d", currentAgent)) {
 					ImGui::SliderFloat("Learning Rate:", &agent->m_beta, 0, 1.f, "%.3f");
+					ImGui::SliderFloat("Lambda:", &agent->m_lambda, 0, 1.f, "%.3f");
+					ImGui::SliderFloat("Trace Cutoff:", &agent->m_traceCutoff, 0, 0.5f, "%.3f");
+					ImGui::Checkbox("Planning", &agent->m_planning);
+					ImGui::InputInt("Planning Steps:", &agent->m_planningSteps, 1, 10);
 					ImGui::TreePop();
 				}
 				currentAgent++;
 			}
 			ImGui::TreePop();
 		}
+		ImGui::Checkbox("Show Policy", &m_showPolicy);
 		if (ImGui::BeginChild("Results", ImVec2(ImGui::GetWindowContentRegionWidth(), m_windowHeight / 2),false,ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse)) {
 			ImGui::SetWindowFontScale(fontScale);
 			if(ImGui::TreeNode("Show Results")) {
-				ImGui::SliderInt("Agent Selected", &agentSelected, 0, m_agents.size() - 1, "%.d");
+				ImGui::SliderInt("Agent Selected", &agentSelected, 0, m_pool.size() - 1, "%.d");
 				std::string temp = "Avg Reward";
 				if (!plotPoints.empty()) {
 					auto & rewards = plotPoints.at(agentSelected);
@@ -590,41 +795,102 @@ void Game::runAlgoApproximated()
 {
 	float currentTime = SDL_GetTicks() / 1000.0f;
 	float timeDif = 0;
-	m_agents.clear();
+	// The networks replace the crowd's table, dropped so it is neither checkpointed nor loaded into
+	m_pool.clear();
+	m_sharedTable = nullptr;
+	m_gradientPool.start(m_gradientThreads - 1);
 	for (int i = 0; i < m_numAgents; ++i) {
-		m_agents.push_back(new Agent(env, m_renderer));
-		m_agents.at(i)->initModels();
+		// A shared policy crowd acts and learns with the first agent's network
+		if (m_sharedPolicy && i > 0) {
+			m_pool.addMember(m_pool.at(0));
+			continue;
+		}
+		auto agent = new Agent(env);
+		agent->setObservation(m_observation, m_viewRadius);
+		agent->m_fusedKernel = m_fusedKernel;
+		agent->m_gradientWorkers = &m_gradientPool;
+		agent->setBatchSize(m_dqnBatchSize);
+		agent->m_targetTau = m_targetTau;
+		agent->initModels();
+		agent->setReplayCapacity(m_replayCapacity);
+		agent->m_replayWithReplacement = m_replayWithReplacement;
+		agent->setPrioritizedReplay(m_prioritizedReplay, m_priorityAlpha, m_priorityBeta);
+		if (m_replaySeed != 0)
+			agent->seedReplay(m_replaySeed + i);
+		agent->m_scheduler.m_warmupSteps = m_warmupSteps;
+		agent->m_scheduler.m_gradientStepsPerStep = m_gradientStepsPerStep;
+		m_pool.add(agent);
 	}
 	agentSelected = 0;
 	resetAlgorithm();
+	if (m_resumeFromCheckpoint)
+		loadCheckpoint(m_checkpointPath);
 	m_algoStarted = true;
 
+	// Asynchronous training overlaps acting and learning, the episodes below then only play the greedy policy once
+	bool async = m_dqnActors > 0;
+	int episodes = numEpisodes;
+	if (async) {
+		AsyncDQNTrainer trainer;
+		trainer.m_numActors = m_dqnActors;
+		trainer.m_warmupSteps = m_warmupSteps;
+		for (int i = 0; i < (int)m_pool.m_learners.size(); ++i) {
+			auto stats = trainer.run(*m_pool.m_learners[i], env, numEpisodes, maxIterations, m_pool.m_epsilon[i], m_pool.m_epsilonDecay[i]);
+			std::cout << "Agent " << i << " trained by " << m_dqnActors << " actors: " << stats.environmentSteps << " steps and " << stats.gradientSteps << " gradient steps over " << stats.episodes << " episodes in " << stats.seconds << "s" << std::endl;
+		}
+		for (int i = 0; i < m_pool.size(); ++i) {
+			m_pool.m_epsilon[i] = 0;
+		}
+		episodes = 1;
+	}
+
+	// Each tick every agent that exploits submits its state, the network values come from one batched pass per network
+	InferenceBatch inference;
+	std::vector<int> tickets(m_pool.size());
+	long long ticks = 0;
+	long long passes = 0;
+	long long evaluated = 0;
+
 	float rewardSum = 0;
 	float average = 0;
-	for (int i = 0; i < numEpisodes; ++i) {
+	for (int i = 0; i < episodes; ++i) {
 		std::cout << "Episode " << i << "\n";
 		std::cout << "=================================================" << std::endl;
 		std::vector<std::vector<EpisodeVals>> episodeData;
-		episodeData.resize(m_agents.size());
+		episodeData.resize(m_pool.size());
 		std::vector<AgentTrainingValues> agentVals;
-		for (int i = 0; i < m_agents.size(); ++i) {
-			auto & agent = m_agents.at(i);
-			agent->m_done = false;
-			auto states = env.getSpawnablePoint();
+		m_pool.setAllDone(false);
+		for (int i = 0; i < m_pool.size(); ++i) {
 			std::pair<int, int> state(0, 0);
-			agent->m_previousState = state;
-			agent->m_currentState = state;
+			m_pool.m_previousState[i] = state;
+			m_pool.m_currentState[i] = state;
 			agentVals.push_back(AgentTrainingValues(env));
 		}
 		while (true) {
-			int currentAgent = 0;
-			for (auto agent : m_agents) {
-				if (!agent->m_done) {
-					// Chose action
-					int action = agent->getAction(env);
+			// Gather, the states are all observed before anyone moves this tick
+			inference.clear();
+			for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
+				tickets[currentAgent] = -1;
+				Agent * network = m_pool.at(currentAgent);
+				if (!m_pool.m_done[currentAgent] && !network->explores(m_pool.m_epsilon[currentAgent], m_pool.m_random[currentAgent]))
+					tickets[currentAgent] = inference.submit(network, m_pool.m_currentState[currentAgent]);
+			}
+			inference.run();
+			ticks++;
+			passes += inference.getPasses();
+			evaluated += inference.size();
+
+			for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
+				if (!m_pool.m_done[currentAgent]) {
+					auto learner = m_pool.at(currentAgent);
+					auto & currentState = m_pool.m_currentState[currentAgent];
+					auto & previousState = m_pool.m_previousState[currentAgent];
+					// Chose action from the network's predicted values, or at random if the agent explores
+					const float * values = tickets[currentAgent] >= 0 ? inference.values(tickets[currentAgent]) : nullptr;
+					int action = learner->getActionDQN(env, currentState, previousState, values, m_pool.m_random[currentAgent]);
 
 					// Environment step returing reward, nextstate and done
-					auto state_vals = env.step(action, agent->m_currentState);
+					auto state_vals = env.step(action, currentState);
 					auto state_next = std::get<0>(state_vals);
 					auto reward = std::get<1>(state_vals);
 					bool done = std::get<2>(state_vals);
@@ -632,22 +898,24 @@ void Game::runAlgoApproximated()
 					auto mem = Agent::AgentMemoryBatch();
 					mem.action = action;
 					mem.done = done;
-					mem.state = agent->m_currentState;
+					mem.state = currentState;
 					mem.nextState = state_next;
 					mem.reward = reward;
 
-					agent->replayMemory(mem);
+					if (!async) {
+						learner->replayMemory(mem);
 
-					// Train every step
-					agent->trainReplay();
+						// Train every step
+						learner->trainReplay();
+					}
 
-					agent->m_previousState = agent->m_currentState;
-					agent->m_currentState = state_next;
-					env.setAgentFlags(agent->m_previousState, agent->m_currentState);
+					previousState = currentState;
+					currentState = state_next;
+					env.setAgentFlags(previousState, currentState);
 
 					EpisodeVals vals;
 					vals.action = action;
-					vals.state = agent->m_previousState;
+					vals.state = previousState;
 					vals.nextState = state_next;
 					episodeData.at(currentAgent).push_back(vals);
 
@@ -655,44 +923,40 @@ void Game::runAlgoApproximated()
 					agentVals.at(currentAgent).reward_episode += reward;
 					agentVals.at(currentAgent).state = state_next;
 					if (agentVals.at(currentAgent).iter_episode >= maxIterations || done) {
-						agent->m_done = true;
+						m_pool.m_done[currentAgent] = true;
 						if (agentVals.at(currentAgent).iter_episode < maxIterations) {
-							agent->updateTargetModel();
+							learner->updateTargetModel();
 						}
 					}
 					if (agentVals.at(currentAgent).iter_episode % 100 == 0) {
 						std::cout << "Update model for " << currentAgent << std::endl;
-						agent->updateTargetModel();
+						learner->updateTargetModel();
 					}
 				}
-				currentAgent++;
 			}
 
 			// Only finish when all agents are finished
-			auto pred = [](const Agent *a) {
-				return !a->m_done;
-			};
-			if (!(std::find_if(m_agents.begin(), m_agents.end(), pred) != m_agents.end()))
+			if (m_pool.allDone())
 				break;
 		}
 
-		for (auto agent : m_agents) {
-			agent->m_epsilon = std::fmax(agent->m_epsilon * agent->m_epsilonDecay, 0.01);
-		}
+		m_pool.decayEpsilon(0.01f);
 
-		int currentAgent = 0;
-		for (auto agent : m_agents) {
+		for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
 			rewardSum += agentVals.at(currentAgent).reward_episode;
-			std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << agent->m_epsilon << " iter: " << agentVals.at(currentAgent).iter_episode << " Rew: " << agentVals.at(currentAgent).reward_episode << " Num Cols: " << agentVals.at(currentAgent).m_numCollisions << std::endl;
-			currentAgent++;
+			std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << m_pool.m_epsilon[currentAgent] << " iter: " << agentVals.at(currentAgent).iter_episode << " Rew: " << agentVals.at(currentAgent).reward_episode << " Num Cols: " << agentVals.at(currentAgent).m_numCollisions << std::endl;
 		}
 	}
 	average = rewardSum / numEpisodes;
+	if (ticks > 0)
+		std::cout << evaluated << " states evaluated in " << passes << " forward passes over " << ticks << " ticks" << std::endl;
 	// Display the final policy
-	for (auto agent : m_agents) {
+	for (auto agent : m_pool.m_learners) {
 		std::cout << "Agent: " << std::endl;
 		agent->displayGreedyPolicy(env);
+		std::cout << agent->m_scheduler.getGradientSteps() << " gradient steps over " << agent->m_scheduler.getEnvironmentSteps() << " environment steps" << std::endl;
 	}
+	m_gradientPool.stop();
 	m_algoStarted = false;
 	m_algoFinished = true;
 	timeDif = (SDL_GetTicks() / 1000) - currentTime;
@@ -707,11 +971,12 @@ void Game::runJAQL()
 	float beta = 0.99f;
 	float gamma = 0.99f;
 	agentEpsilon = 1;
-	m_agents.clear();
+	m_pool.clear();
+	m_sharedTable = nullptr;
 	for (int i = 0; i < 2; ++i) {
-		m_agents.push_back(new Agent(env, m_renderer));
+		m_pool.add(new Agent(env));
 	}
-	int n = m_agents.size();
+	int n = m_pool.size();
 	auto stateDim = env.getStateDim();
 	auto actionDim = env.getActionDim();
 	int numStates = stateDim.first * stateDim.second;
@@ -759,42 +1024,40 @@ void Game::runJAQL()
 	}
 	agentSelected = 0;
 	resetAlgorithm();
+	if (m_resumeFromCheckpoint)
+		loadCheckpoint(m_checkpointPath);
 	m_algoStarted = true;
 	m_episodeData.clear();
 
 	for (int i = 0; i < numEpisodes; ++i) {
 		std::cout << "=================================================" << std::endl;
 		std::vector<std::vector<EpisodeVals>> episodeData;
-		episodeData.resize(m_agents.size());
+		episodeData.resize(m_pool.size());
 		std::vector<AgentTrainingValues> agentVals;
-		for (int i = 0; i < m_agents.size(); ++i) {
-			auto & agent = m_agents.at(i);
-			agent->m_done = false;
+		m_pool.setAllDone(false);
+		for (int i = 0; i < m_pool.size(); ++i) {
 			auto states = env.getSpawnablePoint();
 			std::pair<int, int> state = states.at(std::rand() % states.size());
-			agent->m_previousState = state;
-			agent->m_currentState = state;
+			m_pool.m_previousState[i] = state;
+			m_pool.m_currentState[i] = state;
 			agentVals.push_back(AgentTrainingValues(env));
 		}
-		auto pred = [](const Agent *a) {
-			return !a->m_done;
-		};
 		// While no agent done
-		while (std::find_if(m_agents.begin(), m_agents.end(), pred) != m_agents.end()) {
+		while (!m_pool.allDone()) {
 			// Chose action
 			auto action = getJAQAction();
 			std::cout << "A:" << action.first << ", " << action.second << std::endl;
 
 			// Environment step returing reward, nextstate and done
 			std::vector<int> actions = { action.first, action.second };
-			std::vector<State> states = { m_agents.at(0)->m_currentState, m_agents.at(1)->m_currentState };
+			std::vector<State> states = { m_pool.m_currentState[0], m_pool.m_currentState[1] };
 			auto state_vals = env.stepJAQL(actions, states);
 			auto state_next = std::get<0>(state_vals);
 			auto reward = std::get<1>(state_vals);
 			bool done = std::get<2>(state_vals);
 
 
-			std::vector<State> jointStates{ m_agents[0]->m_currentState,  m_agents[1]->m_currentState };
+			std::vector<State> jointStates{ m_pool.m_currentState[0],  m_pool.m_currentState[1] };
 			float & sa = Q[jointStates][action];
 			auto nextActions = Q[state_next];
 
@@ -802,40 +1065,36 @@ void Game::runJAQL()
 			auto maxVal = maxElement.second;
 			Q[jointStates][action] += beta * (reward + gamma * maxVal - sa);
 		}
-		if (std::find_if(m_agents.begin(), m_agents.end(), pred) != m_agents.end()) {
+		if (!m_pool.allDone()) {
 			// backtrack all agents
-			for (auto & agent : m_agents) {
-				agent->m_currentState = agent->m_previousState;
-			}
+			m_pool.m_currentState = m_pool.m_previousState;
 			auto action = getJAQAction();
 			std::vector<int> actions = { action.first, action.second };
-			std::vector<State> states = { m_agents.at(0)->m_currentState, m_agents.at(1)->m_currentState };
+			std::vector<State> states = { m_pool.m_currentState[0], m_pool.m_currentState[1] };
 			auto state_vals = env.stepJAQL(actions, states);
 			auto state_next = std::get<0>(state_vals);
 			auto reward = std::get<1>(state_vals);
 			bool done = std::get<2>(state_vals);
 
-			std::vector<State> jointStates{ m_agents[0]->m_currentState,  m_agents[1]->m_currentState };
+			std::vector<State> jointStates{ m_pool.m_currentState[0],  m_pool.m_currentState[1] };
 			float & sa = Q[jointStates][action];
 			auto nextActions = Q[state_next];
 			auto maxElement = *std::max_element(nextActions.begin(), nextActions.end());
 			auto maxVal = maxElement.second;
 			Q[jointStates][action] += beta * (reward + gamma * maxVal - sa);
 		}
-		agentEpsilon = std::fmax(agentEpsilon * m_agents.at(0)->m_epsilonDecay, 0.01);
+		agentEpsilon = std::fmax(agentEpsilon * m_pool.m_epsilonDecay[0], 0.01);
 
-		int currentAgent = 0;
-		for (auto agent : m_agents) {
+		for (int currentAgent = 0; currentAgent < m_pool.size(); ++currentAgent) {
 			std::cout << "Episode: " << i << " /" << numEpisodes << " Eps: " << agentEpsilon << " iter: " << agentVals.at(currentAgent).iter_episode << " Rew: " << agentVals.at(currentAgent).reward_episode << " Num Cols: " << agentVals.at(currentAgent).m_numCollisions << std::endl;
-			currentAgent++;
 		}
-		for (int i = 0; i < m_agents.size(); ++i) {
+		for (int i = 0; i < m_pool.size(); ++i) {
 			plotPoints.at(i).push_back(agentVals.at(i).reward_episode);
 		}
 		m_episodeData.push_back(episodeData);
 	}
 	// Display the final policy
-	for (auto agent : m_agents) {
+	for (auto agent : m_pool.m_agents) {
 		std::cout << "Agent: " << std::endl;
 		agent->displayGreedyPolicy(env);
 	}
@@ -859,12 +1118,12 @@ std::pair<int, int> Game::getJAQAction()
 
 	if (randVal < agentEpsilon) {
 		// Generate random allowed actions
-		auto actions_allowed = env.allowedActions(m_agents.at(0)->m_currentState);
+		auto actions_allowed = env.allowedActions(m_pool.m_currentState[0]);
 		std::uniform_int_distribution<int>  distr(0, actions_allowed.size() - 1);
 		int index = distr(generator);
 		std::pair<int, int> actions;
 		actions.first = actions_allowed.at(index);
-		actions_allowed = env.allowedActions(m_agents.at(1)->m_currentState);
+		actions_allowed = env.allowedActions(m_pool.m_currentState[1]);
 		distr = std::uniform_int_distribution<int>(0, actions_allowed.size() - 1);
 		index = distr(generator);
 		actions.second = actions_allowed.at(index);
@@ -872,11 +1131,11 @@ std::pair<int, int> Game::getJAQAction()
 	}
 	else {
 		// Determine best joint action state
-		std::vector<State> currentStates{ m_agents.at(0)->m_currentState, m_agents.at(1)->m_currentState };
+		std::vector<State> currentStates{ m_pool.m_currentState[0], m_pool.m_currentState[1] };
 		auto actionValues = Q[currentStates];
 
-		auto actions_allowed = env.allowedActions(m_agents.at(0)->m_currentState);
-		auto actions_allowed2 = env.allowedActions(m_agents.at(1)->m_currentState);
+		auto actions_allowed = env.allowedActions(m_pool.m_currentState[0]);
+		auto actions_allowed2 = env.allowedActions(m_pool.m_currentState[1]);
 		std::vector<std::pair<int, int>> possibleActionPairs;
 		for (auto action : actions_allowed) {
 			for (auto & a2 : actions_allowed2) {
@@ -906,6 +1165,184 @@ std::pair<int, int> Game::getJAQAction()
 	}
 }
 
+/// <summary>
+/// Add an agent to the pool.
+/// In shared policy mode only the first agent gets a learner, learning into the crowd wide Q table, every later
+/// agent is a row of the pool acting and learning with it.
+/// </summary>
+void Game::addAgent()
+{
+	if (!m_sharedPolicy) {
+		m_pool.add(new Agent(env));
+		return;
+	}
+	if (m_pool.size() > 0) {
+		m_pool.addMember(m_pool.at(0));
+		return;
+	}
+	if (!m_sharedTable) {
+		auto stateDim = env.getStateDim();
+		m_sharedTable = std::make_shared<QTable>();
+		m_sharedTable->setPrecision(m_qPrecision);
+		m_sharedTable->setStorage(m_qStorage);
+		m_sharedTable->resize(stateDim.first, stateDim.second, env.getActionDim().first);
+	}
+	m_pool.add(new Agent(env, m_sharedTable));
+}
+
+/// <summary>
+/// Recreate every agent after switching between individual and shared policies
+/// </summary>
+void Game::rebuildAgents()
+{
+	m_pool.clear();
+	m_sharedTable = nullptr;
+	m_numAgents = std::min(m_numAgents, m_sharedPolicy ? m_maxSharedAgents : m_maxAgents);
+	for (int i = 0; i < m_numAgents; ++i) {
+		addAgent();
+	}
+	agentSelected = 0;
+}
+
+/// <summary>
+/// Export the selected agent's DQN, or the crowd's in shared policy mode, for the PolicyRuntime.
+/// The file is opened again with the runtime so a policy that will not load is reported straight away.
+/// A quantized policy is checked against the fp32 model on replayed states, reporting how often the greedy
+/// action agrees and the cost of int8 against fp32 inference
+/// </summary>
+/// <param name="path">Path of the policy file</param>
+/// <returns>If the policy was written and loads</returns>
+bool Game::exportPolicy(const std::string & path)
+{
+	if (m_pool.size() == 0)
+		return false;
+	auto agent = m_pool.at(m_sharedPolicy ? 0 : agentSelected);
+	int calibrationStates = m_quantizePolicy ? m_calibrationStates : 0;
+	if (agent->getModel().depth() == 0 || !agent->exportPolicy(path, calibrationStates)) {
+		std::cout << "Failed to export a policy to " << path << ", train a DQN first" << std::endl;
+		return false;
+	}
+	PolicyRuntime runtime;
+	if (!runtime.open(path)) {
+		std::cout << "Exported policy " << path << " does not load" << std::endl;
+		return false;
+	}
+	std::cout << "Exported policy " << path << ": " << runtime.getLayerCount() << " layers, " << runtime.getInputs() << " inputs, " << runtime.getOutputs() << " outputs" << std::endl;
+	if (!m_quantizePolicy)
+		return true;
+	if (!runtime.isQuantized()) {
+		std::cout << "Policy was not quantized, the agent has no replayed states to calibrate on" << std::endl;
+		return true;
+	}
+
+	std::vector<State> states;
+	std::vector<float> features;
+	std::vector<float> reference;
+	agent->getReplayStates(m_calibrationStates, states);
+	agent->encodeStates(states, features);
+	agent->predictBatch(states, reference);
+	int count = (int)states.size();
+	int outputs = runtime.getOutputs();
+	std::vector<float> quantized(count * outputs);
+	runtime.evaluateBatch(features.data(), count, quantized.data());
+	int agree = 0;
+	float maxError = 0;
+	for (int i = 0; i < count; ++i) {
+		const float * expected = &reference[i * outputs];
+		const float * actual = &quantized[i * outputs];
+		if (std::max_element(expected, expected + outputs) - expected == std::max_element(actual, actual + outputs) - actual)
+			agree++;
+		for (int o = 0; o < outputs; ++o) {
+			maxError = std::max(maxError, std::abs(expected[o] - actual[o]));
+		}
+	}
+
+	// Time the same batch through the runtime in fp32 and int8
+	const int repeats = 50;
+	double seconds[2];
+	for (int mode = 0; mode < 2; ++mode) {
+		runtime.setQuantized(mode == 1);
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			runtime.evaluateBatch(features.data(), count, quantized.data());
+		}
+		seconds[mode] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	double evaluated = (double)count * repeats;
+	std::cout << "Int8 policy agrees with the fp32 model on " << agree << " of " << count << " replayed states' greedy actions, max output error " << maxError << std::endl;
+	std::cout << "Inference per state: fp32 " << seconds[0] / evaluated * 1e9 << "ns, int8 " << seconds[1] / evaluated * 1e9 << "ns" << std::endl;
+	return true;
+}
+
+/// <summary>
+/// Save every learned table, model and exploration value to a checkpoint file
+/// </summary>
+/// <param name="path">Path of the checkpoint file</param>
+/// <returns>If the checkpoint was written</returns>
+bool Game::saveCheckpoint(const std::string & path)
+{
+	Checkpoint checkpoint;
+	if (m_sharedTable)
+		checkpoint.addQTable(Checkpoint::SHARED_ID, *m_sharedTable);
+	for (int i = 0; i < (int)m_pool.m_learners.size(); ++i) {
+		auto agent = m_pool.m_learners[i];
+		if (!agent->sharesTable())
+			checkpoint.addQTable(i, agent->Q);
+		if (agent->getModel().depth() > 0) {
+			checkpoint.addModel(QLCSectionModel, i, agent->getModel());
+			checkpoint.addModel(QLCSectionTargetModel, i, agent->getTargetModel());
+		}
+	}
+	if (!Q.empty())
+		checkpoint.addJointQ(Q);
+	checkpoint.addExploration(m_pool.m_epsilon);
+	bool saved = checkpoint.save(path);
+	std::cout << (saved ? "Saved checkpoint " : "Failed to save checkpoint ") << path << std::endl;
+	return saved;
+}
+
+/// <summary>
+/// Load learned tables, models and exploration values from a checkpoint file into the current agents.
+/// Tables are only loaded when their dimensions match the current environment.
+/// </summary>
+/// <param name="path">Path of the checkpoint file</param>
+/// <returns>If anything was loaded</returns>
+bool Game::loadCheckpoint(const std::string & path)
+{
+	Checkpoint checkpoint;
+	if (!checkpoint.open(path)) {
+		std::cout << "Failed to open checkpoint " << path << std::endl;
+		return false;
+	}
+	int loaded = 0;
+	if (m_sharedTable && checkpoint.loadQTable(Checkpoint::SHARED_ID, *m_sharedTable))
+		loaded++;
+	for (int i = 0; i < (int)m_pool.m_learners.size(); ++i) {
+		auto agent = m_pool.m_learners[i];
+		if (!agent->sharesTable() && checkpoint.loadQTable(i, agent->Q))
+			loaded++;
+		if (checkpoint.hasSection(QLCSectionModel, i)) {
+			if (agent->getModel().depth() == 0)
+				agent->initModels();
+			if (checkpoint.loadModel(QLCSectionModel, i, agent->getModel()))
+				loaded++;
+			if (checkpoint.loadModel(QLCSectionTargetModel, i, agent->getTargetModel()))
+				loaded++;
+			agent->reloadKernels();
+		}
+	}
+	if (checkpoint.loadJointQ(Q))
+		loaded++;
+	std::vector<float> epsilon;
+	if (checkpoint.loadExploration(epsilon)) {
+		for (int i = 0; i < m_pool.size() && i < (int)epsilon.size(); ++i) {
+			m_pool.m_epsilon[i] = epsilon[i];
+		}
+	}
+	std::cout << "Loaded " << loaded << " tables and models from checkpoint " << path << std::endl;
+	return loaded > 0;
+}
+
 /// <summary>
 /// Set the imgui cherry theme style
 /// </summary>
@@ -1010,35 +1447,39 @@ void Game::mapUI()
 /// <summary>
 /// Multithreaded agent simulation
 /// </summary>
-/// <param name="agent">Pointer to the agent to simulate</param>
+/// <param name="currentAgent">Index of the agent in the pool to simulate</param>
 /// <param name="agentVals">pointer to the agemnt training values to write to</param>
-/// <param name="currentAgent">The current agent for referencing agent training values</param>
 /// <returns>thread to attach to main process</returns>
-std::thread Game::agentSim(Agent * agent, std::vector<AgentTrainingValues> * agentVals, int currentAgent)
+std::thread Game::agentSim(int currentAgent, std::vector<AgentTrainingValues> * agentVals)
 {
 	return std::thread([=] {
-		while (!agent->m_done) {
+		Agent * agent = m_pool.m_agents[currentAgent];
+		State & currentState = m_pool.m_currentState[currentAgent];
+		State & previousState = m_pool.m_previousState[currentAgent];
+		bool frozen = m_convergenceStop == QLCConvergencePerAgent && agent->m_convergence.converged();
+		while (!m_pool.m_done[currentAgent]) {
 			int action;
 			if (current_item == "Q Learning") {
-				action = agent->getAction(env);
+				action = agent->getAction(env, currentState, previousState, frozen ? 0.f : m_pool.m_epsilon[currentAgent], m_pool.m_random[currentAgent]);
 			}
 			else {
-				action = agent->getActionRBMBased(env);
+				action = agent->getActionRBMBased(env, currentState);
 			}
-			auto state_vals = env.step(action, agent->m_currentState);
+			auto state_vals = env.step(action, currentState);
 			auto state_next = std::get<0>(state_vals);
 			auto reward = std::get<1>(state_vals);
 			bool done = std::get<2>(state_vals);
-			agent->m_previousState = agent->m_currentState;
-			agent->train(std::make_tuple(agent->m_currentState, action, state_next, reward, done));
-			agent->setOrientation(action);
-			agent->m_currentState = state_next;
+			previousState = currentState;
+			if (!frozen)
+				agent->train(std::make_tuple(currentState, action, state_next, reward, done));
+			m_pool.setOrientation(currentAgent, action);
+			currentState = state_next;
 
 			agentVals->at(currentAgent).iter_episode += 1;
 			agentVals->at(currentAgent).reward_episode += reward;
 			agentVals->at(currentAgent).state = state_next;
 			if (agentVals->at(currentAgent).iter_episode >= maxIterations || done)
-				agent->m_done = true;
+				m_pool.m_done[currentAgent] = true;
 		}
 	});
 }
@@ -7,6 +7,12 @@
 
 #include "Environment.h"
 #include "Agent.h"
+#include "AgentPool.h"
+#include "ValueIteration.h"
+#include "Checkpoint.h"
+#include "ActorLearner.h"
+#include "AsyncDQNTrainer.h"
+#include "InferenceBatch.h"
 
 #include "imgui/imgui.h"
 #include "imgui_impl_sdl.h"
@@ -38,7 +44,7 @@ class Game {
 public:
 	Game();
 	~Game();
-	std::thread agentSim(Agent * agent, std::vector<AgentTrainingValues> * agentVals, int currentAgent);
+	std::thread agentSim(int currentAgent, std::vector<AgentTrainingValues> * agentVals);
 
 	void update(float deltaTime);
 	void render();
@@ -50,10 +56,16 @@ public:
 	void resetSimulation();
 	void resetAlgorithm();
 	void renderUI();
+	void renderPolicy();
 	void runAlgoApproximated();
 	void runJAQL();
 	bool disableInputs;
 	std::pair<int, int> getJAQAction();
+	void addAgent();
+	void rebuildAgents();
+	bool saveCheckpoint(const std::string & path);
+	bool loadCheckpoint(const std::string & path);
+	bool exportPolicy(const std::string & path);
 
 	int agentEpsilon;
 private:
@@ -67,7 +79,7 @@ private:
 	SDL_Event m_event;
 	Environment env;
 
-	std::vector<Agent *> m_agents;
+	AgentPool m_pool;
 	int currentEpisode = 0;
 	int currentIteration;
 	bool lerping = false;
@@ -83,7 +95,52 @@ private:
 	int maxIterations = 100;
 	std::vector<std::vector<float>> plotPoints;
 	const char* current_item = nullptr;
-	const char* items[4] = { "Q Learning", "RBM" , "MultiRBM", "DQN"};
+	const char* items[7] = { "Q Learning", "Q(Lambda)", "SARSA(Lambda)", "Optimal", "RBM" , "MultiRBM", "DQN"};
+
+	// Exact baseline for the tabular learners
+	ValueIteration m_valueIteration;
+	bool m_warmStart = false;
+	QLCQPrecision m_qPrecision = QLCQFloat32;
+	QLCQStorage m_qStorage = QLCQDense;
+
+	// Early termination once the learners stop changing
+	QLCConvergenceStop m_convergenceStop = QLCConvergenceOff;
+	int m_stableEpisodes = 20;
+	float m_tdThreshold = 0.05f;
+
+	// Actors feeding one Q learning learner each, 1 trains on the agents' own trajectories
+	int m_numActors = 1;
+
+	// DQN experience replay, a seed of 0 leaves every agent randomly seeded
+	int m_replayCapacity = 1000;
+	int m_replaySeed = 0;
+	bool m_replayWithReplacement = false;
+	bool m_prioritizedReplay = false;
+	float m_priorityAlpha = 0.6f;
+	float m_priorityBeta = 0.4f;
+	int m_warmupSteps = 100;
+	float m_gradientStepsPerStep = 1.f;
+	QLCObservation m_observation = QLCObservationOffsets;
+	int m_viewRadius = 4;
+	bool m_fusedKernel = false;
+	float m_targetTau = 1.f;			// 1 copies the online network into the target, below 1 Polyak averages every gradient step
+	int m_dqnActors = 0;				// 0 trains on the calling thread, otherwise actors feed a learner thread
+	int m_dqnBatchSize = 32;
+	int m_gradientThreads = 1;		// Threads sharing each fused kernel minibatch gradient
+	WorkerPool m_gradientPool;
+
+	// Checkpointing of learned tables and models
+	char m_checkpointPath[256] = "checkpoint.qlc";
+	bool m_resumeFromCheckpoint = false;
+
+	// Inference only export of a trained DQN
+	char m_policyPath[256] = "policy.qlp";
+	bool m_quantizePolicy = false;
+	int m_calibrationStates = 1000;		// Replay states the int8 scales are calibrated and checked on
+
+	// Shared policy mode, every agent learns into one crowd wide Q table
+	bool m_sharedPolicy = false;
+	std::shared_ptr<QTable> m_sharedTable;
 
 	// Episode simulation Data
 	std::vector<std::vector<std::vector<EpisodeVals>>> m_episodeData;
@@ -92,6 +149,8 @@ private:
 	std::vector<bool> m_agentLerping;
 	std::vector<int> m_agentIterations;
 	int m_numAgents = 1;
+	const int m_maxAgents = 100;
+	const int m_maxSharedAgents = 20000;
 	std::vector<std::thread> m_threads;
 	std::thread m_runThread;
 	bool m_multiThreaded = false;
@@ -107,6 +166,7 @@ private:
 	ImVec2 algoSize;
 
 	int agentSelected = 0;
+	bool m_showPolicy = false;
 	ImFont * m_font;
 	float fontScale = 1.25;
 	bool resultsActive;
@@ -114,7 +174,7 @@ private:
 
 	// JAQL
 	typedef std::map<std::pair<int, int>, float> jointAction;
-	std::map<std::vector<std::pair<int, int>>, jointAction> Q;
+	JointQTable Q;
 };
 
 #endif // !GAME_H
\ No newline at end of file
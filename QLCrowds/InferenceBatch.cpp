@@ -0,0 +1,80 @@
+#include "InferenceBatch.h"
+
+/// <summary>
+/// Default inference batch constructor
+/// </summary>
+InferenceBatch::InferenceBatch()
+{
+}
+
+InferenceBatch::~InferenceBatch()
+{
+}
+
+/// <summary>
+/// Drop the last tick's submissions
+/// </summary>
+void InferenceBatch::clear()
+{
+	for (int i = 0; i < m_numGroups; ++i) {
+		m_groups[i].states.clear();
+	}
+	m_numGroups = 0;
+	m_tickets.clear();
+}
+
+/// <summary>
+/// Queue a state for evaluation by an agent's network
+/// </summary>
+/// <param name="network">The agent whose network evaluates the state</param>
+/// <param name="state">The state to evaluate</param>
+/// <returns>Ticket to read the values with once run</returns>
+int InferenceBatch::submit(Agent * network, const State & state)
+{
+	int group = 0;
+	while (group < m_numGroups && m_groups[group].network != network) {
+		group++;
+	}
+	if (group == m_numGroups) {
+		if (m_numGroups == (int)m_groups.size())
+			m_groups.emplace_back();
+		m_groups[group].network = network;
+		m_numGroups++;
+	}
+	m_groups[group].states.push_back(state);
+	m_tickets.push_back(std::make_pair(group, (int)m_groups[group].states.size() - 1));
+	return (int)m_tickets.size() - 1;
+}
+
+/// <summary>
+/// Evaluate everything submitted, one forward pass per network
+/// </summary>
+void InferenceBatch::run()
+{
+	for (int i = 0; i < m_numGroups; ++i) {
+		Group & group = m_groups[i];
+		group.network->predictBatch(group.states, group.values);
+	}
+}
+
+/// <summary>
+/// The action values of a submission, valid until the next clear
+/// </summary>
+const float * InferenceBatch::values(int ticket) const
+{
+	auto & entry = m_tickets[ticket];
+	return &m_groups[entry.first].values[entry.second * am::NUM_ACTIONS];
+}
+
+int InferenceBatch::size() const
+{
+	return (int)m_tickets.size();
+}
+
+/// <summary>
+/// Forward passes the last run made
+/// </summary>
+int InferenceBatch::getPasses() const
+{
+	return m_numGroups;
+}
@@ -0,0 +1,38 @@
+#ifndef INFERENCEBATCH_H
+#define INFERENCEBATCH_H
+
+#include <vector>
+#include "Agent.h"
+
+/// <summary>
+/// Gathers the states every agent wants evaluated in a tick and evaluates them together.
+/// Submissions are grouped by the agent whose network answers them, each group is encoded into one contiguous
+/// batch and run in a single forward pass, then every caller reads its values back by ticket. A crowd sharing
+/// one network therefore costs one pass per tick however many agents it has, agents with their own networks
+/// still get one pass each. Group buffers are kept between ticks so a steady crowd never allocates.
+/// </summary>
+class InferenceBatch {
+public:
+	InferenceBatch();
+	~InferenceBatch();
+
+	void clear();
+	int submit(Agent * network, const State & state);
+	void run();
+	const float * values(int ticket) const;
+
+	int size() const;
+	int getPasses() const;
+private:
+	struct Group {
+		Agent * network = nullptr;
+		std::vector<State> states;
+		std::vector<float> values;	// am::NUM_ACTIONS per state
+	};
+
+	std::vector<Group> m_groups;
+	int m_numGroups = 0;				// Groups in use this tick, the rest only keep their buffers
+	std::vector<std::pair<int, int>> m_tickets;	// Group and row of every submission
+};
+
+#endif //!INFERENCEBATCH_H
@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+
+/// <summary>
+/// Read only memory mapping of a whole file.
+/// The file contents are paged in on demand by the OS rather than read into a buffer up front.
+/// </summary>
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string & path);
+	void close();
+	bool isOpen() const;
+
+	const char * data() const;
+	size_t size() const;
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const char * m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void * m_file = nullptr;
+	void * m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
+
+#endif //!MAPPEDFILE_H
@@ -0,0 +1,508 @@
+#include "MlpKernel.h"
+#include "Simd.h"
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	// Hidden and output widths are padded to a multiple of this so the loops below never need a tail
+	const int s_vectorWidth = 8;
+
+	// Samples forwardBatch runs together, each weight row loaded serves all of them
+	const int s_batchBlock = 4;
+
+	int padToVector(int size)
+	{
+		return (size + s_vectorWidth - 1) / s_vectorWidth * s_vectorWidth;
+	}
+
+	/// <summary>
+	/// y += a * x over n values, n a multiple of the vector width
+	/// </summary>
+	inline void axpy(float * y, const float * x, float a, int n)
+	{
+#if defined(QLC_AVX2)
+		__m256 scale = _mm256_set1_ps(a);
+		for (int i = 0; i < n; i += 8) {
+			_mm256_storeu_ps(y + i, _mm256_fmadd_ps(scale, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+		}
+#elif defined(QLC_SSE)
+		__m128 scale = _mm_set1_ps(a);
+		for (int i = 0; i < n; i += 4) {
+			_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(scale, _mm_loadu_ps(x + i))));
+		}
+#else
+		for (int i = 0; i < n; ++i) {
+			y[i] += a * x[i];
+		}
+#endif
+	}
+
+	/// <summary>
+	/// y[k] += a[k] * x over n values for each of s_batchBlock outputs, x is loaded once for all of them.
+	/// Every output gets exactly the arithmetic axpy would give it, a 0 scale leaves it unchanged
+	/// </summary>
+	inline void axpyBlock(float * const * y, const float * x, const float * a, int n)
+	{
+#if defined(QLC_AVX2)
+		__m256 scale0 = _mm256_set1_ps(a[0]);
+		__m256 scale1 = _mm256_set1_ps(a[1]);
+		__m256 scale2 = _mm256_set1_ps(a[2]);
+		__m256 scale3 = _mm256_set1_ps(a[3]);
+		for (int i = 0; i < n; i += 8) {
+			__m256 v = _mm256_loadu_ps(x + i);
+			_mm256_storeu_ps(y[0] + i, _mm256_fmadd_ps(scale0, v, _mm256_loadu_ps(y[0] + i)));
+			_mm256_storeu_ps(y[1] + i, _mm256_fmadd_ps(scale1, v, _mm256_loadu_ps(y[1] + i)));
+			_mm256_storeu_ps(y[2] + i, _mm256_fmadd_ps(scale2, v, _mm256_loadu_ps(y[2] + i)));
+			_mm256_storeu_ps(y[3] + i, _mm256_fmadd_ps(scale3, v, _mm256_loadu_ps(y[3] + i)));
+		}
+#elif defined(QLC_SSE)
+		__m128 scale0 = _mm_set1_ps(a[0]);
+		__m128 scale1 = _mm_set1_ps(a[1]);
+		__m128 scale2 = _mm_set1_ps(a[2]);
+		__m128 scale3 = _mm_set1_ps(a[3]);
+		for (int i = 0; i < n; i += 4) {
+			__m128 v = _mm_loadu_ps(x + i);
+			_mm_storeu_ps(y[0] + i, _mm_add_ps(_mm_loadu_ps(y[0] + i), _mm_mul_ps(scale0, v)));
+			_mm_storeu_ps(y[1] + i, _mm_add_ps(_mm_loadu_ps(y[1] + i), _mm_mul_ps(scale1, v)));
+			_mm_storeu_ps(y[2] + i, _mm_add_ps(_mm_loadu_ps(y[2] + i), _mm_mul_ps(scale2, v)));
+			_mm_storeu_ps(y[3] + i, _mm_add_ps(_mm_loadu_ps(y[3] + i), _mm_mul_ps(scale3, v)));
+		}
+#else
+		for (int i = 0; i < n; ++i) {
+			float v = x[i];
+			for (int k = 0; k < s_batchBlock; ++k) {
+				y[k][i] += a[k] * v;
+			}
+		}
+#endif
+	}
+
+	/// <summary>
+	/// Dot product of n values, n a multiple of the vector width
+	/// </summary>
+	inline float dot(const float * x, const float * y, int n)
+	{
+#if defined(QLC_AVX2)
+		__m256 sum = _mm256_setzero_ps();
+		for (int i = 0; i < n; i += 8) {
+			sum = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sum);
+		}
+		__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+		half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+		return _mm_cvtss_f32(half);
+#elif defined(QLC_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < n; i += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+		}
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+#else
+		float sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += x[i] * y[i];
+		}
+		return sum;
+#endif
+	}
+
+	/// <summary>
+	/// Clamp negatives to 0 over n values, n a multiple of the vector width
+	/// </summary>
+	inline void relu(float * x, int n)
+	{
+#if defined(QLC_AVX2)
+		__m256 zero = _mm256_setzero_ps();
+		for (int i = 0; i < n; i += 8) {
+			_mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+		}
+#elif defined(QLC_SSE)
+		__m128 zero = _mm_setzero_ps();
+		for (int i = 0; i < n; i += 4) {
+			_mm_storeu_ps(x + i, _mm_max_ps(_mm_loadu_ps(x + i), zero));
+		}
+#else
+		for (int i = 0; i < n; ++i) {
+			x[i] = std::max(x[i], 0.f);
+		}
+#endif
+	}
+}
+
+/// <summary>
+/// Default kernel constructor, the kernel is unusable until built or loaded
+/// </summary>
+MlpKernel::MlpKernel()
+{
+}
+
+MlpKernel::~MlpKernel()
+{
+}
+
+/// <summary>
+/// Allocate a zeroed network of the given size
+/// </summary>
+/// <param name="inputs">Input features</param>
+/// <param name="hidden">Hidden units</param>
+/// <param name="outputs">Outputs, one per action</param>
+/// <returns>If the sizes were valid</returns>
+bool MlpKernel::build(int inputs, int hidden, int outputs)
+{
+	if (inputs <= 0 || hidden <= 0 || outputs <= 0)
+		return false;
+	m_inputs = inputs;
+	m_hidden = hidden;
+	m_outputs = outputs;
+	m_hiddenStride = padToVector(hidden);
+	m_outputStride = padToVector(outputs);
+
+	m_w1 = 0;
+	m_b1 = m_w1 + m_inputs * m_hiddenStride;
+	m_w2 = m_b1 + m_hiddenStride;
+	m_b2 = m_w2 + m_hiddenStride * m_outputStride;
+	m_params.assign(m_b2 + m_outputStride, 0.f);
+
+	m_hiddenValues.assign(s_batchBlock * m_hiddenStride, 0.f);
+	m_logits.assign(s_batchBlock * m_outputStride, 0.f);
+	m_gradient.assign(m_params.size(), 0.f);
+	m_shards.clear();
+	resetOptimizer();
+	return true;
+}
+
+/// <summary>
+/// Take the weights of a two layer dense network, the layout must be W1 b1 W2 b2
+/// </summary>
+/// <param name="model">The tiny_dnn model to copy from</param>
+/// <returns>If the model had the expected shape</returns>
+bool MlpKernel::load(mw::Model & model)
+{
+	auto layout = mw::layout(model);
+	if (layout.size() != 4 || layout[1] == 0 || layout[3] == 0)
+		return false;
+	int hidden = (int)layout[1];
+	int outputs = (int)layout[3];
+	int inputs = (int)layout[0] / hidden;
+	if ((int)layout[0] != inputs * hidden || (int)layout[2] != hidden * outputs)
+		return false;
+	if (inputs != m_inputs || hidden != m_hidden || outputs != m_outputs)
+		build(inputs, hidden, outputs);
+	else
+		std::fill(m_params.begin(), m_params.end(), 0.f);
+
+	auto values = mw::flatten(model);
+	const float * data = values.data();
+	for (int c = 0; c < m_inputs; ++c, data += m_hidden) {
+		std::copy(data, data + m_hidden, &m_params[m_w1 + c * m_hiddenStride]);
+	}
+	std::copy(data, data + m_hidden, &m_params[m_b1]);
+	data += m_hidden;
+	for (int j = 0; j < m_hidden; ++j, data += m_outputs) {
+		std::copy(data, data + m_outputs, &m_params[m_w2 + j * m_outputStride]);
+	}
+	std::copy(data, data + m_outputs, &m_params[m_b2]);
+	return true;
+}
+
+/// <summary>
+/// Write the weights back into a tiny_dnn model of the same shape
+/// </summary>
+/// <param name="model">The tiny_dnn model to copy to</param>
+/// <returns>If the model had the same shape as the kernel</returns>
+bool MlpKernel::store(mw::Model & model) const
+{
+	std::vector<float> values;
+	values.reserve(m_inputs * m_hidden + m_hidden + m_hidden * m_outputs + m_outputs);
+	for (int c = 0; c < m_inputs; ++c) {
+		auto row = m_params.begin() + m_w1 + c * m_hiddenStride;
+		values.insert(values.end(), row, row + m_hidden);
+	}
+	values.insert(values.end(), m_params.begin() + m_b1, m_params.begin() + m_b1 + m_hidden);
+	for (int j = 0; j < m_hidden; ++j) {
+		auto row = m_params.begin() + m_w2 + j * m_outputStride;
+		values.insert(values.end(), row, row + m_outputs);
+	}
+	values.insert(values.end(), m_params.begin() + m_b2, m_params.begin() + m_b2 + m_outputs);
+	return mw::unflatten(model, values.data(), values.size());
+}
+
+/// <summary>
+/// Copy the weights of a kernel of the same shape, used to sync a target network
+/// </summary>
+void MlpKernel::copyWeights(const MlpKernel & other)
+{
+	if (other.m_inputs != m_inputs || other.m_hidden != m_hidden || other.m_outputs != m_outputs)
+		build(other.m_inputs, other.m_hidden, other.m_outputs);
+	m_params = other.m_params;
+}
+
+/// <summary>
+/// Polyak average another kernel's weights into this one, weights = tau * other + (1 - tau) * weights
+/// </summary>
+void MlpKernel::blendWeights(const MlpKernel & other, float tau)
+{
+	if (other.m_inputs != m_inputs || other.m_hidden != m_hidden || other.m_outputs != m_outputs) {
+		copyWeights(other);
+		return;
+	}
+	mw::blend(m_params.data(), other.m_params.data(), tau, m_params.size());
+}
+
+/// <summary>
+/// If the kernel holds a network
+/// </summary>
+bool MlpKernel::ready() const
+{
+	return m_inputs > 0;
+}
+
+/// <summary>
+/// Run one sample through the network
+/// </summary>
+/// <param name="input">getInputs() features</param>
+/// <param name="output">getOutputs() values</param>
+void MlpKernel::forward(const float * input, float * output)
+{
+	forwardHidden(input, m_hiddenValues.data());
+	forwardOutput(m_hiddenValues.data(), output, m_logits.data());
+}
+
+/// <summary>
+/// Run a batch of samples stored one after another through the network.
+/// Samples go through in blocks so every weight row is loaded once per block rather than once per sample,
+/// the values are the same as running each sample through forward
+/// </summary>
+void MlpKernel::forwardBatch(const float * inputs, int batch, float * outputs)
+{
+	int i = 0;
+	for (; i + s_batchBlock <= batch; i += s_batchBlock) {
+		forwardBlock(inputs + i * m_inputs, outputs + i * m_outputs);
+	}
+	for (; i < batch; ++i) {
+		forward(inputs + i * m_inputs, outputs + i * m_outputs);
+	}
+}
+
+/// <summary>
+/// Run s_batchBlock samples through the network together, rows no sample uses are skipped
+/// </summary>
+void MlpKernel::forwardBlock(const float * inputs, float * outputs)
+{
+	float * hidden[s_batchBlock];
+	float * logits[s_batchBlock];
+	float scales[s_batchBlock];
+	for (int k = 0; k < s_batchBlock; ++k) {
+		hidden[k] = &m_hiddenValues[k * m_hiddenStride];
+		logits[k] = &m_logits[k * m_outputStride];
+		std::copy(m_params.begin() + m_b1, m_params.begin() + m_b1 + m_hiddenStride, hidden[k]);
+		std::copy(m_params.begin() + m_b2, m_params.begin() + m_b2 + m_outputStride, logits[k]);
+	}
+	for (int c = 0; c < m_inputs; ++c) {
+		bool active = false;
+		for (int k = 0; k < s_batchBlock; ++k) {
+			scales[k] = inputs[k * m_inputs + c];
+			active |= scales[k] != 0;
+		}
+		if (active)
+			axpyBlock(hidden, &m_params[m_w1 + c * m_hiddenStride], scales, m_hiddenStride);
+	}
+	for (int k = 0; k < s_batchBlock; ++k) {
+		relu(hidden[k], m_hiddenStride);
+	}
+	for (int j = 0; j < m_hidden; ++j) {
+		bool active = false;
+		for (int k = 0; k < s_batchBlock; ++k) {
+			scales[k] = hidden[k][j];
+			active |= scales[k] > 0;
+		}
+		if (active)
+			axpyBlock(logits, &m_params[m_w2 + j * m_outputStride], scales, m_outputStride);
+	}
+	for (int k = 0; k < s_batchBlock; ++k) {
+		softmax(logits[k], outputs + k * m_outputs);
+	}
+}
+
+/// <summary>
+/// One Adam step on the mean squared error of a batch.
+/// The batch is cut into m_numShards even shards whose gradients are computed independently, spread over the
+/// workers when there are any, then summed in shard order. The shards depend on the batch size alone, never on
+/// the number of threads, so a step gives the same weights however many threads compute it
+/// </summary>
+/// <param name="inputs">batch samples of getInputs() features</param>
+/// <param name="targets">batch rows of getOutputs() targets</param>
+/// <param name="batch">Number of samples</param>
+/// <param name="workers">Threads to compute the shards on, the calling thread alone if null</param>
+/// <returns>The batch's mean loss before the step</returns>
+float MlpKernel::train(const float * inputs, const float * targets, int batch, WorkerPool * workers)
+{
+	if (batch <= 0)
+		return 0;
+	int shardSize = (batch + std::max(1, m_numShards) - 1) / std::max(1, m_numShards);
+	int numShards = (batch + shardSize - 1) / shardSize;
+	if ((int)m_shards.size() < numShards)
+		m_shards.resize(numShards);
+	auto shardTask = [&](int shard) {
+		int begin = shard * shardSize;
+		accumulate(m_shards[shard], inputs, targets, begin, std::min(batch, begin + shardSize));
+	};
+	if (workers)
+		workers->run(numShards, shardTask);
+	else
+		for (int shard = 0; shard < numShards; ++shard) {
+			shardTask(shard);
+		}
+
+	// Deterministic reduction, always in shard order
+	std::copy(m_shards[0].gradient.begin(), m_shards[0].gradient.end(), m_gradient.begin());
+	float loss = m_shards[0].loss;
+	for (int shard = 1; shard < numShards; ++shard) {
+		axpy(m_gradient.data(), m_shards[shard].gradient.data(), 1.f, (int)m_gradient.size());
+		loss += m_shards[shard].loss;
+	}
+
+	// Adam on the batch mean gradient, padding has no gradient so it stays 0
+	m_beta1Power *= m_beta1;
+	m_beta2Power *= m_beta2;
+	float scale = 1.f / batch;
+	float correction1 = 1.f / (1.f - m_beta1Power);
+	float correction2 = 1.f / (1.f - m_beta2Power);
+	for (size_t p = 0; p < m_params.size(); ++p) {
+		float g = m_gradient[p] * scale;
+		m_moment1[p] = m_beta1 * m_moment1[p] + (1.f - m_beta1) * g;
+		m_moment2[p] = m_beta2 * m_moment2[p] + (1.f - m_beta2) * g * g;
+		m_params[p] -= m_alpha * (m_moment1[p] * correction1) / (sqrtf(m_moment2[p] * correction2) + m_epsilon);
+	}
+	return loss / batch;
+}
+
+/// <summary>
+/// Sum the loss and gradient of samples begin to end into a shard, reads the weights only so shards can run at once
+/// </summary>
+void MlpKernel::accumulate(Shard & shard, const float * inputs, const float * targets, int begin, int end) const
+{
+	if (shard.gradient.size() != m_params.size()) {
+		// Padding lanes of the deltas are never written and must stay 0
+		shard.gradient.assign(m_params.size(), 0.f);
+		shard.hidden.assign(m_hiddenStride, 0.f);
+		shard.logits.assign(m_outputStride, 0.f);
+		shard.output.assign(m_outputStride, 0.f);
+		shard.outputDelta.assign(m_outputStride, 0.f);
+		shard.hiddenDelta.assign(m_hiddenStride, 0.f);
+	}
+	std::fill(shard.gradient.begin(), shard.gradient.end(), 0.f);
+	shard.loss = 0;
+	float * gradient = shard.gradient.data();
+	float * output = shard.output.data();
+	float * outputDelta = shard.outputDelta.data();
+	float * hiddenDelta = shard.hiddenDelta.data();
+	for (int i = begin; i < end; ++i) {
+		const float * input = inputs + i * m_inputs;
+		const float * target = targets + i * m_outputs;
+		forwardHidden(input, shard.hidden.data());
+		forwardOutput(shard.hidden.data(), output, shard.logits.data());
+
+		// d mse / d output, then back through the softmax
+		float weighted = 0;
+		for (int o = 0; o < m_outputs; ++o) {
+			float error = output[o] - target[o];
+			shard.loss += error * error / m_outputs;
+			outputDelta[o] = 2.f * error / m_outputs;
+			weighted += outputDelta[o] * output[o];
+		}
+		for (int o = 0; o < m_outputs; ++o) {
+			outputDelta[o] = output[o] * (outputDelta[o] - weighted);
+		}
+
+		// Output layer gradient and the error reaching each hidden unit through the relu
+		axpy(&gradient[m_b2], outputDelta, 1.f, m_outputStride);
+		for (int j = 0; j < m_hidden; ++j) {
+			float h = shard.hidden[j];
+			if (h > 0) {
+				axpy(&gradient[m_w2 + j * m_outputStride], outputDelta, h, m_outputStride);
+				hiddenDelta[j] = dot(&m_params[m_w2 + j * m_outputStride], outputDelta, m_outputStride);
+			}
+			else {
+				hiddenDelta[j] = 0;
+			}
+		}
+
+		// Hidden layer gradient
+		axpy(&gradient[m_b1], hiddenDelta, 1.f, m_hiddenStride);
+		for (int c = 0; c < m_inputs; ++c) {
+			if (input[c] != 0)
+				axpy(&gradient[m_w1 + c * m_hiddenStride], hiddenDelta, input[c], m_hiddenStride);
+		}
+	}
+}
+
+/// <summary>
+/// Drop the Adam moment estimates
+/// </summary>
+void MlpKernel::resetOptimizer()
+{
+	m_moment1.assign(m_params.size(), 0.f);
+	m_moment2.assign(m_params.size(), 0.f);
+	m_beta1Power = 1;
+	m_beta2Power = 1;
+}
+
+int MlpKernel::getInputs() const
+{
+	return m_inputs;
+}
+
+int MlpKernel::getHidden() const
+{
+	return m_hidden;
+}
+
+int MlpKernel::getOutputs() const
+{
+	return m_outputs;
+}
+
+/// <summary>
+/// Fused dense + relu, each input scales its row of weights into the hidden units
+/// </summary>
+void MlpKernel::forwardHidden(const float * input, float * hidden) const
+{
+	std::copy(m_params.begin() + m_b1, m_params.begin() + m_b1 + m_hiddenStride, hidden);
+	for (int c = 0; c < m_inputs; ++c) {
+		if (input[c] != 0)
+			axpy(hidden, &m_params[m_w1 + c * m_hiddenStride], input[c], m_hiddenStride);
+	}
+	relu(hidden, m_hiddenStride);
+}
+
+/// <summary>
+/// Dense output layer followed by a softmax, inactive hidden units are skipped. z is scratch for the padded logits
+/// </summary>
+void MlpKernel::forwardOutput(const float * hidden, float * output, float * z) const
+{
+	std::copy(m_params.begin() + m_b2, m_params.begin() + m_b2 + m_outputStride, z);
+	for (int j = 0; j < m_hidden; ++j) {
+		if (hidden[j] > 0)
+			axpy(z, &m_params[m_w2 + j * m_outputStride], hidden[j], m_outputStride);
+	}
+	softmax(z, output);
+}
+
+/// <summary>
+/// Softmax of the logits z into output
+/// </summary>
+void MlpKernel::softmax(const float * z, float * output) const
+{
+	float maxLogit = *std::max_element(z, z + m_outputs);
+	float sum = 0;
+	for (int o = 0; o < m_outputs; ++o) {
+		output[o] = expf(z[o] - maxLogit);
+		sum += output[o];
+	}
+	for (int o = 0; o < m_outputs; ++o) {
+		output[o] /= sum;
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef MLPKERNEL_H
+#define MLPKERNEL_H
+
+#include <vector>
+#include "ModelWeights.h"
+#include "WorkerPool.h"
+
+/// <summary>
+/// Fused inference and training for the small two layer DQN, dense + relu then dense + softmax.
+/// tiny_dnn spends more on layer dispatch and allocation than on arithmetic for networks this size, here the
+/// whole network is two loops over weights that stay in cache. Weights are the model's, W[input * outputs + output]
+/// then the bias for each layer, kept internally with the hidden and output widths padded to the vector width so
+/// every inner loop is whole vectors. Training is mse with Adam, matching how the tiny_dnn model is fitted.
+/// </summary>
+class MlpKernel {
+public:
+	MlpKernel();
+	~MlpKernel();
+
+	float m_alpha = 0.001f;		// Adam step size
+	float m_beta1 = 0.9f;
+	float m_beta2 = 0.999f;
+	float m_epsilon = 1e-8f;
+	int m_numShards = 8;		// Gradient shards per minibatch, fixed so a step never depends on the thread count
+
+	bool build(int inputs, int hidden, int outputs);
+	bool load(mw::Model & model);
+	bool store(mw::Model & model) const;
+	void copyWeights(const MlpKernel & other);
+	void blendWeights(const MlpKernel & other, float tau);
+	bool ready() const;
+
+	void forward(const float * input, float * output);
+	void forwardBatch(const float * inputs, int batch, float * outputs);
+	float train(const float * inputs, const float * targets, int batch, WorkerPool * workers = nullptr);
+	void resetOptimizer();
+
+	int getInputs() const;
+	int getHidden() const;
+	int getOutputs() const;
+private:
+	int m_inputs = 0;
+	int m_hidden = 0;
+	int m_outputs = 0;
+	int m_hiddenStride = 0;		// Hidden width padded to the vector width
+	int m_outputStride = 0;		// Output width padded to the vector width
+
+	// Parameters in one block so they stay together in cache, W1 b1 W2 b2 with padded strides
+	std::vector<float> m_params;
+	int m_w1 = 0;
+	int m_b1 = 0;
+	int m_w2 = 0;
+	int m_b2 = 0;
+
+	// Training state
+	std::vector<float> m_gradient;
+	std::vector<float> m_moment1;
+	std::vector<float> m_moment2;
+	float m_beta1Power = 1;
+	float m_beta2Power = 1;
+
+	// Scratch for a block of samples, forward uses the first
+	std::vector<float> m_hiddenValues;
+	std::vector<float> m_logits;
+
+	// Gradient of one slice of a minibatch with the scratch to compute it
+	struct Shard {
+		std::vector<float> gradient;
+		std::vector<float> hidden;
+		std::vector<float> logits;
+		std::vector<float> output;
+		std::vector<float> outputDelta;
+		std::vector<float> hiddenDelta;
+		float loss = 0;
+	};
+	std::vector<Shard> m_shards;
+
+	void forwardHidden(const float * input, float * hidden) const;
+	void forwardOutput(const float * hidden, float * output, float * logits) const;
+	void forwardBlock(const float * inputs, float * outputs);
+	void softmax(const float * z, float * output) const;
+	void accumulate(Shard & shard, const float * inputs, const float * targets, int begin, int end) const;
+};
+
+#endif //!MLPKERNEL_H
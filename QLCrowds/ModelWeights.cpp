@@ -0,0 +1,150 @@
+#include "ModelWeights.h"
+#include "Simd.h"
+#include <algorithm>
+
+namespace mw {
+	/// <summary>
+	/// Get the size of every weight vector in the network in parameter order
+	/// </summary>
+	std::vector<uint32_t> layout(Model & model)
+	{
+		std::vector<uint32_t> sizes;
+		for (size_t i = 0; i < model.depth(); ++i) {
+			for (auto weights : model[i]->weights()) {
+				sizes.push_back((uint32_t)weights->size());
+			}
+		}
+		return sizes;
+	}
+
+	/// <summary>
+	/// Get the total number of trainable parameters in the network
+	/// </summary>
+	size_t parameterCount(Model & model)
+	{
+		size_t count = 0;
+		for (auto size : layout(model)) {
+			count += size;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// Copy every parameter of the network into one array
+	/// </summary>
+	std::vector<float> flatten(Model & model)
+	{
+		std::vector<float> values;
+		values.reserve(parameterCount(model));
+		for (size_t i = 0; i < model.depth(); ++i) {
+			for (auto weights : model[i]->weights()) {
+				values.insert(values.end(), weights->begin(), weights->end());
+			}
+		}
+		return values;
+	}
+
+	/// <summary>
+	/// Overwrite the parameters of the network from one array
+	/// </summary>
+	/// <param name="model">The network to write to</param>
+	/// <param name="data">Parameters in the order produced by flatten</param>
+	/// <param name="count">Number of parameters available</param>
+	/// <returns>If the count matched the network and the parameters were written</returns>
+	bool unflatten(Model & model, const float * data, size_t count)
+	{
+		if (count != parameterCount(model))
+			return false;
+		// Mark the layers initialised first so the next fit does not reinitialise over the loaded values
+		model.init_weight();
+		for (size_t i = 0; i < model.depth(); ++i) {
+			for (auto weights : model[i]->weights()) {
+				std::copy(data, data + weights->size(), weights->begin());
+				data += weights->size();
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// If two networks have the same number of layers and the same weight vector sizes in every layer
+	/// </summary>
+	bool sameLayout(Model & a, Model & b)
+	{
+		if (a.depth() != b.depth())
+			return false;
+		for (size_t i = 0; i < a.depth(); ++i) {
+			auto weightsA = a[i]->weights();
+			auto weightsB = b[i]->weights();
+			if (weightsA.size() != weightsB.size())
+				return false;
+			for (size_t w = 0; w < weightsA.size(); ++w) {
+				if (weightsA[w]->size() != weightsB[w]->size())
+					return false;
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Copy the parameters of one network into another with the same layout, the layers themselves are untouched
+	/// </summary>
+	/// <returns>If the layouts matched and the parameters were copied</returns>
+	bool copy(Model & target, Model & source)
+	{
+		if (!sameLayout(target, source))
+			return false;
+		for (size_t i = 0; i < source.depth(); ++i) {
+			auto sourceWeights = source[i]->weights();
+			auto targetWeights = target[i]->weights();
+			for (size_t w = 0; w < sourceWeights.size(); ++w) {
+				std::copy(sourceWeights[w]->begin(), sourceWeights[w]->end(), targetWeights[w]->begin());
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Polyak average the parameters of source into target, target = tau * source + (1 - tau) * target
+	/// </summary>
+	/// <returns>If the layouts matched and the parameters were blended</returns>
+	bool blend(Model & target, Model & source, float tau)
+	{
+		if (!sameLayout(target, source))
+			return false;
+		for (size_t i = 0; i < source.depth(); ++i) {
+			auto sourceWeights = source[i]->weights();
+			auto targetWeights = target[i]->weights();
+			for (size_t w = 0; w < sourceWeights.size(); ++w) {
+				blend(&(*targetWeights[w])[0], &(*sourceWeights[w])[0], tau, sourceWeights[w]->size());
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// target = tau * source + (1 - tau) * target over count values, in one vectorized pass
+	/// </summary>
+	void blend(float * target, const float * source, float tau, size_t count)
+	{
+		size_t i = 0;
+#if defined(QLC_AVX2)
+		__m256 keep = _mm256_set1_ps(1.f - tau);
+		__m256 take = _mm256_set1_ps(tau);
+		for (; i + 8 <= count; i += 8) {
+			__m256 kept = _mm256_mul_ps(keep, _mm256_loadu_ps(target + i));
+			_mm256_storeu_ps(target + i, _mm256_fmadd_ps(take, _mm256_loadu_ps(source + i), kept));
+		}
+#elif defined(QLC_SSE)
+		__m128 keep = _mm_set1_ps(1.f - tau);
+		__m128 take = _mm_set1_ps(tau);
+		for (; i + 4 <= count; i += 4) {
+			__m128 kept = _mm_mul_ps(keep, _mm_loadu_ps(target + i));
+			_mm_storeu_ps(target + i, _mm_add_ps(kept, _mm_mul_ps(take, _mm_loadu_ps(source + i))));
+		}
+#endif
+		for (; i < count; ++i) {
+			target[i] = tau * source[i] + (1.f - tau) * target[i];
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef MODELWEIGHTS_H
+#define MODELWEIGHTS_H
+
+#include <vector>
+#include <stdint.h>
+#include <tiny_dnn/tiny_dnn.h>
+
+/// <summary>
+/// Helpers for moving the trainable parameters of a network in and out of flat arrays.
+/// Parameters are ordered layer by layer, then by weight vector within the layer (weights before biases).
+/// </summary>
+namespace mw {
+	typedef tiny_dnn::network<tiny_dnn::sequential> Model;
+
+	std::vector<uint32_t> layout(Model & model);
+	size_t parameterCount(Model & model);
+	std::vector<float> flatten(Model & model);
+	bool unflatten(Model & model, const float * data, size_t count);
+	bool sameLayout(Model & a, Model & b);
+	bool copy(Model & target, Model & source);
+	bool blend(Model & target, Model & source, float tau);
+	void blend(float * target, const float * source, float tau, size_t count);
+}
+
+#endif //!MODELWEIGHTS_H
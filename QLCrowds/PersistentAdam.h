@@ -0,0 +1,29 @@
+#ifndef PERSISTENTADAM_H
+#define PERSISTENTADAM_H
+
+#include <tiny_dnn/tiny_dnn.h>
+
+/// <summary>
+/// Adam whose moment estimates survive between calls to fit.
+/// tiny_dnn resets the optimizer at the start of every fit, which for a DQN that fits one minibatch per call
+/// throws the moments away every step and leaves Adam permanently in its bias corrected first step.
+/// That reset is ignored here and clear() is called explicitly when the model being optimized changes.
+/// </summary>
+class PersistentAdam : public tiny_dnn::adam {
+public:
+	void reset() override
+	{
+	}
+
+	/// <summary>
+	/// Drop the moment estimates and restart the bias correction
+	/// </summary>
+	void clear()
+	{
+		tiny_dnn::adam::reset();
+		b1_t = b1;
+		b2_t = b2;
+	}
+};
+
+#endif //!PERSISTENTADAM_H
@@ -0,0 +1,169 @@
+#include "Planner.h"
+#include <algorithm>
+#include <math.h>
+
+/// <summary>
+/// Default planner constructor, the model is empty until resized
+/// </summary>
+Planner::Planner() :
+	m_generator(std::random_device()())
+{
+}
+
+/// <summary>
+/// Planner deconstructor
+/// </summary>
+Planner::~Planner()
+{
+}
+
+/// <summary>
+/// Resize the model to the given state and action dimensions clearing all observations.
+/// The model is only allocated once the first transition is observed so agents that never plan stay small.
+/// </summary>
+/// <param name="rows">Number of rows in the environment</param>
+/// <param name="cols">Number of columns in the environment</param>
+/// <param name="actions">Number of actions per state</param>
+void Planner::resize(int rows, int cols, int actions)
+{
+	m_rows = rows;
+	m_cols = cols;
+	m_actions = actions;
+	reset();
+}
+
+/// <summary>
+/// Forget all observed transitions, empty the planning queue and release the model memory
+/// </summary>
+void Planner::reset()
+{
+	std::vector<ModelEntry>().swap(m_model);
+	std::vector<std::vector<int>>().swap(m_predecessors);
+	std::vector<float>().swap(m_priority);
+	std::vector<int>().swap(m_observed);
+	m_queue = std::priority_queue<QueueEntry>();
+}
+
+/// <summary>
+/// Allocate an empty model for the current dimensions
+/// </summary>
+void Planner::allocate()
+{
+	int numStates = m_rows * m_cols;
+	m_model.assign(numStates * m_actions, ModelEntry());
+	m_predecessors.assign(numStates, std::vector<int>());
+	m_priority.assign(numStates * m_actions, 0.f);
+}
+
+/// <summary>
+/// Record a real transition in the model and queue it by its current TD error
+/// </summary>
+/// <param name="Q">The Q table the transition was used to update</param>
+/// <param name="state">The state the action was taken in</param>
+/// <param name="action">The action taken</param>
+/// <param name="nextState">The resulting state</param>
+/// <param name="reward">The reward received</param>
+/// <param name="done">If the next state is terminal</param>
+/// <param name="gamma">Discount factor</param>
+void Planner::observe(QTable & Q, const State & state, int action, const State & nextState, float reward, bool done, float gamma)
+{
+	if (m_model.empty())
+		allocate();
+	int pair = (state.first * m_cols + state.second) * m_actions + action;
+	int next = nextState.first * m_cols + nextState.second;
+	auto & entry = m_model[pair];
+	if (entry.nextState < 0) {
+		m_observed.push_back(pair);
+	}
+	if (entry.nextState != next) {
+		auto & predecessors = m_predecessors[next];
+		if (std::find(predecessors.begin(), predecessors.end(), pair) == predecessors.end())
+			predecessors.push_back(pair);
+	}
+	entry.nextState = next;
+	entry.reward = reward;
+	entry.done = done;
+	push(pair, fabs(tdError(Q, pair, gamma)));
+}
+
+/// <summary>
+/// Run planning backups on the model, highest priority pairs first.
+/// After each backup the predecessors of the updated state are queued if their TD error exceeds the threshold.
+/// </summary>
+/// <param name="Q">The Q table to update</param>
+/// <param name="steps">Maximum number of backups to perform</param>
+/// <param name="beta">Learning rate</param>
+/// <param name="gamma">Discount factor</param>
+/// <returns>The number of backups performed</returns>
+int Planner::plan(QTable & Q, int steps, float beta, float gamma)
+{
+	int backups = 0;
+	for (; backups < steps; ++backups) {
+		int pair;
+		if (!pop(pair)) {
+			if (m_observed.empty())
+				break;
+			std::uniform_int_distribution<int> distr(0, m_observed.size() - 1);
+			pair = m_observed.at(distr(m_generator));
+		}
+		int state = pair / m_actions;
+		int action = pair % m_actions;
+		Q.add(state / m_cols, state % m_cols, action, beta * tdError(Q, pair, gamma));
+
+		for (int predecessor : m_predecessors[state]) {
+			push(predecessor, fabs(tdError(Q, predecessor, gamma)));
+		}
+	}
+	return backups;
+}
+
+/// <summary>
+/// Calculate the TD error of a state action pair using the model outcome
+/// </summary>
+/// <param name="Q">The Q table to evaluate</param>
+/// <param name="pair">Flat index of the state action pair</param>
+/// <param name="gamma">Discount factor</param>
+/// <returns>The TD error of the pair</returns>
+float Planner::tdError(QTable & Q, int pair, float gamma)
+{
+	auto & entry = m_model[pair];
+	int state = pair / m_actions;
+	int action = pair % m_actions;
+	float nextValue = 0;
+	if (!entry.done) {
+		nextValue = Q.maxValue(entry.nextState / m_cols, entry.nextState % m_cols);
+	}
+	return entry.reward + gamma * nextValue - Q.get(state / m_cols, state % m_cols, action);
+}
+
+/// <summary>
+/// Queue a pair for planning if its priority is above the threshold and higher than any queued priority for it
+/// </summary>
+/// <param name="pair">Flat index of the state action pair</param>
+/// <param name="priority">Magnitude of the TD error</param>
+void Planner::push(int pair, float priority)
+{
+	if (priority > m_threshold && priority > m_priority[pair]) {
+		m_priority[pair] = priority;
+		m_queue.push({ priority, pair });
+	}
+}
+
+/// <summary>
+/// Pop the highest priority pair, skipping stale entries superseded by a higher priority
+/// </summary>
+/// <param name="pair">The popped pair</param>
+/// <returns>False if the queue is empty</returns>
+bool Planner::pop(int & pair)
+{
+	while (!m_queue.empty()) {
+		auto top = m_queue.top();
+		m_queue.pop();
+		if (top.priority == m_priority[top.pair]) {
+			m_priority[top.pair] = 0;
+			pair = top.pair;
+			return true;
+		}
+	}
+	return false;
+}
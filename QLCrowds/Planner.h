@@ -0,0 +1,57 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <vector>
+#include <queue>
+#include <random>
+#include "QTable.h"
+
+typedef std::pair<int, int> State;
+
+/// <summary>
+/// Model based planner for the tabular learners (Dyna-Q with prioritized sweeping).
+/// Observed transitions are recorded in a compact model indexed by state and action and
+/// planning backups are drawn from a priority queue keyed on the magnitude of the TD error.
+/// When the queue is empty planning falls back to replaying random observed pairs as in Dyna-Q.
+/// </summary>
+class Planner {
+public:
+	Planner();
+	~Planner();
+
+	float m_threshold = 0.01f;	// Minimum TD error for a pair to be queued for planning
+
+	void resize(int rows, int cols, int actions);
+	void reset();
+	void observe(QTable & Q, const State & state, int action, const State & nextState, float reward, bool done, float gamma);
+	int plan(QTable & Q, int steps, float beta, float gamma);
+private:
+	struct ModelEntry {
+		int nextState = -1;
+		float reward = 0;
+		bool done = false;
+	};
+	struct QueueEntry {
+		float priority;
+		int pair;
+		bool operator<(const QueueEntry & other) const { return priority < other.priority; }
+	};
+
+	int m_rows = 0;
+	int m_cols = 0;
+	int m_actions = 0;
+
+	std::vector<ModelEntry> m_model;				// Last observed outcome for every state action pair
+	std::vector<std::vector<int>> m_predecessors;	// State action pairs observed leading into each state
+	std::vector<float> m_priority;					// Priority a pair is currently queued with, 0 if not queued
+	std::vector<int> m_observed;					// Every pair in the model for random Dyna-Q replay
+	std::priority_queue<QueueEntry> m_queue;
+	std::mt19937 m_generator;
+
+	void allocate();
+	float tdError(QTable & Q, int pair, float gamma);
+	void push(int pair, float priority);
+	bool pop(int & pair);
+};
+
+#endif //!PLANNER_H
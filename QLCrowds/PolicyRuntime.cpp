@@ -0,0 +1,501 @@
+#include "PolicyRuntime.h"
+#include "Simd.h"
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+namespace {
+	// Quantized rows are padded to a multiple of this so the integer dot product never needs a tail
+	const int s_quantizedWidth = 16;
+
+	uint64_t layerSize(uint32_t channels, uint32_t height, uint32_t width)
+	{
+		return (uint64_t)channels * height * width;
+	}
+
+	/// <summary>
+	/// Round to the nearest int8 step, saturating at +-127 so the range stays symmetric
+	/// </summary>
+	inline int16_t toInt8(float value)
+	{
+		value = std::min(127.f, std::max(-127.f, value));
+		return (int16_t)(value >= 0 ? value + 0.5f : value - 0.5f);
+	}
+
+	/// <summary>
+	/// Quantize n values to int8 steps of 1 / inverseScale, the rounding and saturation run a vector at a time
+	/// </summary>
+	inline void quantizeRow(const float * x, float inverseScale, int16_t * q, int n)
+	{
+		int i = 0;
+#if defined(QLC_AVX2) || defined(QLC_SSE)
+		__m128 scale = _mm_set1_ps(inverseScale);
+		__m128 high = _mm_set1_ps(127.f);
+		__m128 low = _mm_set1_ps(-127.f);
+		for (; i + 8 <= n; i += 8) {
+			// Saturate before converting so nothing can overflow the conversion
+			__m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(x + i), scale), low), high);
+			__m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(x + i + 4), scale), low), high);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(q + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+		}
+#endif
+		for (; i < n; ++i) {
+			q[i] = toInt8(x[i] * inverseScale);
+		}
+	}
+
+	/// <summary>
+	/// Integer dot products of x with four rows of w, stride values apart, over n 16 bit values, n a multiple of
+	/// s_quantizedWidth. Values are int8 range so the pairwise products summed by madd can never overflow.
+	/// The four sums share every load of x and one horizontal reduction
+	/// </summary>
+	inline void dot4(const int16_t * x, const int16_t * w, size_t stride, int n, int32_t * out)
+	{
+#if defined(QLC_AVX2) || defined(QLC_SSE)
+		__m128i sums[4];
+#if defined(QLC_AVX2)
+		__m256i wide[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+		for (int i = 0; i < n; i += 16) {
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+			for (int r = 0; r < 4; ++r) {
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + r * stride + i));
+				wide[r] = _mm256_add_epi32(wide[r], _mm256_madd_epi16(a, b));
+			}
+		}
+		for (int r = 0; r < 4; ++r) {
+			sums[r] = _mm_add_epi32(_mm256_castsi256_si128(wide[r]), _mm256_extracti128_si256(wide[r], 1));
+		}
+#else
+		sums[0] = sums[1] = sums[2] = sums[3] = _mm_setzero_si128();
+		for (int i = 0; i < n; i += 8) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + i));
+			for (int r = 0; r < 4; ++r) {
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(w + r * stride + i));
+				sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(a, b));
+			}
+		}
+#endif
+		// Transpose and add so lane r holds the total of row r
+		__m128i s01 = _mm_add_epi32(_mm_unpacklo_epi32(sums[0], sums[1]), _mm_unpackhi_epi32(sums[0], sums[1]));
+		__m128i s23 = _mm_add_epi32(_mm_unpacklo_epi32(sums[2], sums[3]), _mm_unpackhi_epi32(sums[2], sums[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_add_epi32(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23)));
+#else
+		for (int r = 0; r < 4; ++r) {
+			int32_t sum = 0;
+			for (int i = 0; i < n; ++i) {
+				sum += x[i] * w[r * stride + i];
+			}
+			out[r] = sum;
+		}
+#endif
+	}
+}
+
+/// <summary>
+/// Default policy runtime constructor, nothing can be evaluated until a policy is opened
+/// </summary>
+PolicyRuntime::PolicyRuntime()
+{
+}
+
+PolicyRuntime::~PolicyRuntime()
+{
+}
+
+/// <summary>
+/// Map a policy file and check every layer fits the file and feeds the next
+/// </summary>
+/// <param name="path">Path of the policy file</param>
+/// <returns>If the policy is ready to evaluate</returns>
+bool PolicyRuntime::open(const std::string & path)
+{
+	close();
+	if (!m_file.open(path))
+		return false;
+	if (!validate()) {
+		close();
+		return false;
+	}
+	std::vector<float> scales(m_header->layerCount);
+	for (uint32_t i = 0; i < m_header->layerCount; ++i) {
+		scales[i] = m_layers[i].inputScale;
+	}
+	quantize(scales.data());
+	return true;
+}
+
+void PolicyRuntime::close()
+{
+	m_file.close();
+	m_header = nullptr;
+	m_layers = nullptr;
+	m_maxWidth = 0;
+	m_quantized.clear();
+}
+
+bool PolicyRuntime::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+int PolicyRuntime::getInputs() const
+{
+	return m_header ? (int)m_header->inputs : 0;
+}
+
+int PolicyRuntime::getOutputs() const
+{
+	return m_header ? (int)m_header->outputs : 0;
+}
+
+int PolicyRuntime::getObservation() const
+{
+	return m_header ? m_header->observation : 0;
+}
+
+int PolicyRuntime::getViewRadius() const
+{
+	return m_header ? m_header->viewRadius : 0;
+}
+
+int PolicyRuntime::getLayerCount() const
+{
+	return m_header ? (int)m_header->layerCount : 0;
+}
+
+/// <summary>
+/// Evaluate one input of getInputs() values into getOutputs() values
+/// </summary>
+void PolicyRuntime::evaluate(const float * input, float * output)
+{
+	evaluateBatch(input, 1, output);
+}
+
+/// <summary>
+/// Evaluate count inputs, stored one after another, layer by layer so each layer's weights are read once per batch.
+/// Runs in int8 when the policy is calibrated and quantized evaluation is enabled
+/// </summary>
+/// <param name="inputs">count rows of getInputs() values</param>
+/// <param name="count">Number of inputs</param>
+/// <param name="outputs">Receives count rows of getOutputs() values</param>
+void PolicyRuntime::evaluateBatch(const float * inputs, int count, float * outputs)
+{
+	run(inputs, count, outputs, m_useQuantized && isQuantized(), nullptr);
+}
+
+/// <summary>
+/// Find the int8 scale of every dense layer's input from the fp32 activations of representative inputs,
+/// then quantize the policy with them. Scales are per layer, 0 for layers that are not dense
+/// </summary>
+/// <param name="inputs">count rows of getInputs() values, ideally states the policy will meet</param>
+/// <param name="count">Number of inputs</param>
+/// <param name="scales">Receives the scale of every layer, as PolicyWriter::setInputScales takes them</param>
+/// <returns>If the policy is open and there were inputs to calibrate on</returns>
+bool PolicyRuntime::calibrate(const float * inputs, int count, std::vector<float> & scales)
+{
+	if (!m_header || count <= 0)
+		return false;
+	std::vector<float> ranges(m_header->layerCount, 0.f);
+	std::vector<float> outputs((size_t)count * m_header->outputs);
+	run(inputs, count, outputs.data(), false, ranges.data());
+	scales.assign(m_header->layerCount, 0.f);
+	for (uint32_t i = 0; i < m_header->layerCount; ++i) {
+		if (m_layers[i].type == QLCPolicyDense)
+			scales[i] = std::max(ranges[i], 1e-6f) / 127.f;
+	}
+	quantize(scales.data());
+	return true;
+}
+
+/// <summary>
+/// If every dense layer has int8 weights and an input scale
+/// </summary>
+bool PolicyRuntime::isQuantized() const
+{
+	return !m_quantized.empty();
+}
+
+/// <summary>
+/// Choose between int8 and fp32 evaluation of a quantized policy, fp32 is always used otherwise
+/// </summary>
+void PolicyRuntime::setQuantized(bool enabled)
+{
+	m_useQuantized = enabled;
+}
+
+/// <summary>
+/// Run every layer over the batch
+/// </summary>
+/// <param name="quantized">Run dense layers in int8</param>
+/// <param name="ranges">If set receives the largest input magnitude of every layer, each at least its previous value</param>
+void PolicyRuntime::run(const float * inputs, int count, float * outputs, bool quantized, float * ranges)
+{
+	if (!m_header || count <= 0)
+		return;
+	size_t needed = (size_t)count * m_maxWidth;
+	for (auto & buffer : m_buffers) {
+		if (buffer.size() < needed)
+			buffer.resize(needed);
+	}
+	const float * in = inputs;
+	int current = 0;
+	for (uint32_t i = 0; i < m_header->layerCount; ++i) {
+		const LayerHeader & layer = m_layers[i];
+		int inSize = (int)layerSize(layer.inChannels, layer.inHeight, layer.inWidth);
+		if (ranges) {
+			for (int v = 0; v < count * inSize; ++v) {
+				ranges[i] = std::max(ranges[i], fabsf(in[v]));
+			}
+		}
+		float * out = m_buffers[current].data();
+		switch (layer.type) {
+		case QLCPolicyDense:
+			if (quantized)
+				quantizedDense(layer, m_quantized[i], in, out, count);
+			else
+				dense(layer, in, out, count);
+			break;
+		case QLCPolicyConv:
+			conv(layer, in, out, count);
+			break;
+		default: {
+			// Activations work in place, only the caller's inputs need copying first
+			float * data = const_cast<float *>(in);
+			if (in == inputs) {
+				data = out;
+				memcpy(data, in, (size_t)count * inSize * sizeof(float));
+				current ^= 1;
+			}
+			if (layer.type == QLCPolicyRelu)
+				relu(data, count * inSize);
+			else
+				softmax(data, inSize, count);
+			in = data;
+			continue;
+		}
+		}
+		in = out;
+		current ^= 1;
+	}
+	memcpy(outputs, in, (size_t)count * m_header->outputs * sizeof(float));
+}
+
+/// <summary>
+/// Check the header and every layer descriptor against the mapped file
+/// </summary>
+bool PolicyRuntime::validate()
+{
+	const char * data = m_file.data();
+	size_t size = m_file.size();
+	if (size < sizeof(FileHeader))
+		return false;
+	auto header = reinterpret_cast<const FileHeader *>(data);
+	if (header->magic != MAGIC || header->version != VERSION || header->layerCount == 0)
+		return false;
+	if (size < sizeof(FileHeader) + (uint64_t)header->layerCount * sizeof(LayerHeader))
+		return false;
+	auto layers = reinterpret_cast<const LayerHeader *>(data + sizeof(FileHeader));
+
+	uint64_t previous = header->inputs;
+	uint64_t maxWidth = header->inputs;
+	for (uint32_t i = 0; i < header->layerCount; ++i) {
+		const LayerHeader & layer = layers[i];
+		uint64_t inSize = layerSize(layer.inChannels, layer.inHeight, layer.inWidth);
+		uint64_t outSize = layerSize(layer.outChannels, layer.outHeight, layer.outWidth);
+		if (inSize != previous || inSize == 0 || outSize == 0)
+			return false;
+		uint64_t expected = 0;
+		switch (layer.type) {
+		case QLCPolicyDense:
+			expected = inSize * outSize + outSize;
+			break;
+		case QLCPolicyConv:
+			if (layer.kernel == 0 || layer.inWidth < layer.kernel || layer.inHeight < layer.kernel
+				|| layer.outWidth != layer.inWidth - layer.kernel + 1 || layer.outHeight != layer.inHeight - layer.kernel + 1)
+				return false;
+			expected = (uint64_t)layer.outChannels * layer.inChannels * layer.kernel * layer.kernel + layer.outChannels;
+			break;
+		case QLCPolicyRelu:
+		case QLCPolicySoftmax:
+			if (outSize != inSize)
+				return false;
+			break;
+		default:
+			return false;
+		}
+		if (layer.weightCount != expected || !(layer.inputScale >= 0))
+			return false;
+		if (expected > 0 && (layer.weightOffset % ALIGNMENT != 0 || layer.weightOffset > size
+			|| expected > (size - layer.weightOffset) / sizeof(float)))
+			return false;
+		previous = outSize;
+		maxWidth = std::max(maxWidth, outSize);
+	}
+	if (previous != header->outputs)
+		return false;
+	m_header = header;
+	m_layers = layers;
+	m_maxWidth = (int)maxWidth;
+	return true;
+}
+
+/// <summary>
+/// Build int8 weights for every dense layer, quantized symmetrically per output so a small output's weights keep
+/// their precision. Nothing is quantized unless every dense layer has an input scale
+/// </summary>
+/// <param name="scales">Input scale of every layer</param>
+void PolicyRuntime::quantize(const float * scales)
+{
+	m_quantized.clear();
+	for (uint32_t i = 0; i < m_header->layerCount; ++i) {
+		if (m_layers[i].type == QLCPolicyDense && !(scales[i] > 0))
+			return;
+	}
+	m_quantized.resize(m_header->layerCount);
+	for (uint32_t i = 0; i < m_header->layerCount; ++i) {
+		const LayerHeader & layer = m_layers[i];
+		if (layer.type != QLCPolicyDense)
+			continue;
+		QuantizedLayer & quantized = m_quantized[i];
+		int inputs = (int)layerSize(layer.inChannels, layer.inHeight, layer.inWidth);
+		int outputs = (int)layerSize(layer.outChannels, layer.outHeight, layer.outWidth);
+		quantized.paddedInputs = (inputs + s_quantizedWidth - 1) / s_quantizedWidth * s_quantizedWidth;
+		quantized.inverseScale = 1.f / scales[i];
+		quantized.weights.assign((size_t)(outputs + 3) / 4 * 4 * quantized.paddedInputs, 0);
+		quantized.scales.resize(outputs);
+		const float * w = weights(layer);
+		for (int o = 0; o < outputs; ++o) {
+			float largest = 0;
+			for (int c = 0; c < inputs; ++c) {
+				largest = std::max(largest, fabsf(w[(size_t)c * outputs + o]));
+			}
+			float weightScale = largest > 0 ? largest / 127.f : 1.f;
+			// Stored transposed, one contiguous row per output for the dot product
+			int16_t * row = &quantized.weights[(size_t)o * quantized.paddedInputs];
+			for (int c = 0; c < inputs; ++c) {
+				row[c] = toInt8(w[(size_t)c * outputs + o] / weightScale);
+			}
+			quantized.scales[o] = scales[i] * weightScale;
+		}
+	}
+	size_t inputs = 0;
+	for (auto & quantized : m_quantized) {
+		inputs = std::max(inputs, (size_t)quantized.paddedInputs);
+	}
+	m_quantizedInput.assign(inputs, 0);
+}
+
+/// <summary>
+/// Dense layer in int8, each input is quantized with the calibrated scale, inputs outside the calibrated range
+/// saturate. Products accumulate exactly in 32 bit integers and are scaled back to floats once per output
+/// </summary>
+void PolicyRuntime::quantizedDense(const LayerHeader & layer, const QuantizedLayer & quantized, const float * in, float * out, int count)
+{
+	int inputs = (int)layerSize(layer.inChannels, layer.inHeight, layer.inWidth);
+	int outputs = (int)layerSize(layer.outChannels, layer.outHeight, layer.outWidth);
+	const float * bias = weights(layer) + (size_t)inputs * outputs;
+	int16_t * q = m_quantizedInput.data();
+	for (int s = 0; s < count; ++s) {
+		const float * x = in + (size_t)s * inputs;
+		float * y = out + (size_t)s * outputs;
+		quantizeRow(x, quantized.inverseScale, q, inputs);
+		// Rows are padded to whole groups of four, the padding rows are zero
+		int32_t sums[4];
+		for (int o = 0; o < outputs; o += 4) {
+			dot4(q, &quantized.weights[(size_t)o * quantized.paddedInputs], quantized.paddedInputs, quantized.paddedInputs, sums);
+			for (int r = 0; r < 4 && o + r < outputs; ++r) {
+				y[o + r] = sums[r] * quantized.scales[o + r] + bias[o + r];
+			}
+		}
+	}
+}
+
+/// <summary>
+/// A layer's weights in the mapping, aligned since the mapping starts on a page and every layer on ALIGNMENT
+/// </summary>
+const float * PolicyRuntime::weights(const LayerHeader & layer) const
+{
+	return reinterpret_cast<const float *>(m_file.data() + layer.weightOffset);
+}
+
+void PolicyRuntime::dense(const LayerHeader & layer, const float * in, float * out, int count) const
+{
+	int inputs = (int)layerSize(layer.inChannels, layer.inHeight, layer.inWidth);
+	int outputs = (int)layerSize(layer.outChannels, layer.outHeight, layer.outWidth);
+	const float * w = weights(layer);
+	const float * bias = w + (size_t)inputs * outputs;
+	for (int s = 0; s < count; ++s) {
+		const float * x = in + (size_t)s * inputs;
+		float * y = out + (size_t)s * outputs;
+		memcpy(y, bias, outputs * sizeof(float));
+		for (int c = 0; c < inputs; ++c) {
+			float value = x[c];
+			// Local views are mostly empty cells
+			if (value == 0)
+				continue;
+			const float * row = w + (size_t)c * outputs;
+			for (int o = 0; o < outputs; ++o) {
+				y[o] += value * row[o];
+			}
+		}
+	}
+}
+
+void PolicyRuntime::conv(const LayerHeader & layer, const float * in, float * out, int count) const
+{
+	int k = (int)layer.kernel;
+	int inW = (int)layer.inWidth;
+	int inArea = inW * (int)layer.inHeight;
+	int outW = (int)layer.outWidth;
+	int outH = (int)layer.outHeight;
+	int outArea = outW * outH;
+	int inSize = inArea * (int)layer.inChannels;
+	int outSize = outArea * (int)layer.outChannels;
+	const float * w = weights(layer);
+	const float * bias = w + (size_t)layer.outChannels * layer.inChannels * k * k;
+	for (int s = 0; s < count; ++s) {
+		for (uint32_t oc = 0; oc < layer.outChannels; ++oc) {
+			float * plane = out + (size_t)s * outSize + oc * outArea;
+			std::fill(plane, plane + outArea, bias[oc]);
+			for (uint32_t ic = 0; ic < layer.inChannels; ++ic) {
+				const float * source = in + (size_t)s * inSize + ic * inArea;
+				const float * kernel = w + ((size_t)oc * layer.inChannels + ic) * k * k;
+				for (int ky = 0; ky < k; ++ky) {
+					for (int kx = 0; kx < k; ++kx) {
+						float weight = kernel[ky * k + kx];
+						for (int y = 0; y < outH; ++y) {
+							const float * row = source + (y + ky) * inW + kx;
+							float * target = plane + y * outW;
+							for (int x = 0; x < outW; ++x) {
+								target[x] += weight * row[x];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void PolicyRuntime::relu(float * data, int size) const
+{
+	for (int i = 0; i < size; ++i) {
+		data[i] = data[i] > 0 ? data[i] : 0;
+	}
+}
+
+void PolicyRuntime::softmax(float * data, int width, int count) const
+{
+	for (int s = 0; s < count; ++s) {
+		float * row = data + (size_t)s * width;
+		float largest = *std::max_element(row, row + width);
+		float sum = 0;
+		for (int i = 0; i < width; ++i) {
+			row[i] = expf(row[i] - largest);
+			sum += row[i];
+		}
+		for (int i = 0; i < width; ++i) {
+			row[i] /= sum;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#ifndef POLICYRUNTIME_H
+#define POLICYRUNTIME_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "MappedFile.h"
+
+typedef int QLCPolicyLayer;
+/// <summary>
+/// Operations a policy file can hold, the ones the DQN models are built from
+/// </summary>
+enum QLCPolicyLayer_ {
+	QLCPolicyDense = 1,		// Fully connected, W[input * outputs + output] then one bias per output
+	QLCPolicyConv = 2,		// Valid convolution with stride 1, W[((out * inChannels + in) * kernel + y) * kernel + x] then one bias per out channel
+	QLCPolicyRelu = 3,
+	QLCPolicySoftmax = 4
+};
+
+/// <summary>
+/// Inference only runtime for a DQN policy exported by PolicyWriter, needs nothing beyond the standard library.
+/// A policy file is a header, one descriptor per layer, then every layer's weights and biases as floats, each
+/// layer starting on a 64 byte boundary. The file is memory mapped and weights are read in place, so opening a
+/// policy costs a validation pass over the descriptors and its pages are shared by every process using it.
+/// Data is laid out channel by channel then row by row, as the FeatureEncoder writes it.
+/// A policy calibrated on real inputs carries the range of every dense layer's input, and is then also run
+/// in int8: dense weights are quantized per output when the policy is opened, inputs are quantized with the
+/// calibrated scale and the dot products accumulate in 32 bit integers. Convolutions always run in fp32.
+/// </summary>
+class PolicyRuntime {
+public:
+	static const uint32_t MAGIC = 0x50434C51;	// "QLCP"
+	static const uint32_t VERSION = 2;	// 2 added int8 activation scales
+	static const uint32_t ALIGNMENT = 64;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t layerCount;
+		uint32_t inputs;
+		uint32_t outputs;
+		int32_t observation;		// QLCObservation the policy was trained on
+		int32_t viewRadius;
+		uint32_t reserved;
+	};
+	struct LayerHeader {
+		uint32_t type;
+		uint32_t inChannels;
+		uint32_t inHeight;
+		uint32_t inWidth;
+		uint32_t outChannels;
+		uint32_t outHeight;
+		uint32_t outWidth;
+		uint32_t kernel;
+		float inputScale;			// Dense layers, the value of one int8 step of the input, 0 when not calibrated
+		uint32_t reserved;
+		uint64_t weightOffset;		// Bytes from the start of the file
+		uint64_t weightCount;		// Weights followed by biases
+	};
+
+	PolicyRuntime();
+	~PolicyRuntime();
+
+	bool open(const std::string & path);
+	void close();
+	bool isOpen() const;
+
+	int getInputs() const;
+	int getOutputs() const;
+	int getObservation() const;
+	int getViewRadius() const;
+	int getLayerCount() const;
+
+	void evaluate(const float * input, float * output);
+	void evaluateBatch(const float * inputs, int count, float * outputs);
+
+	bool calibrate(const float * inputs, int count, std::vector<float> & scales);
+	bool isQuantized() const;
+	void setQuantized(bool enabled);
+private:
+	struct QuantizedLayer {
+		int paddedInputs = 0;			// Inputs rounded up to whole vectors
+		float inverseScale = 0;			// Input value to int8 steps
+		std::vector<int16_t> weights;	// Output rows of paddedInputs int8 values, widened so they feed a 16 bit multiply add, whole groups of four rows
+		std::vector<float> scales;		// Input scale times the weight scale of each output
+	};
+
+	PolicyRuntime(const PolicyRuntime &);
+	PolicyRuntime & operator=(const PolicyRuntime &);
+
+	MappedFile m_file;
+	const FileHeader * m_header = nullptr;
+	const LayerHeader * m_layers = nullptr;
+	int m_maxWidth = 0;				// Largest activation of any layer
+	std::vector<float> m_buffers[2];	// Activations of the batch, alternated between layers
+	std::vector<QuantizedLayer> m_quantized;	// Per layer, empty unless every dense layer is calibrated
+	std::vector<int16_t> m_quantizedInput;
+	bool m_useQuantized = true;
+
+	bool validate();
+	void run(const float * inputs, int count, float * outputs, bool quantized, float * ranges);
+	void quantize(const float * scales);
+	void quantizedDense(const LayerHeader & layer, const QuantizedLayer & quantized, const float * in, float * out, int count);
+	const float * weights(const LayerHeader & layer) const;
+	void dense(const LayerHeader & layer, const float * in, float * out, int count) const;
+	void conv(const LayerHeader & layer, const float * in, float * out, int count) const;
+	void relu(float * data, int size) const;
+	void softmax(float * data, int width, int count) const;
+};
+
+#endif //!POLICYRUNTIME_H
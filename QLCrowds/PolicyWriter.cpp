@@ -0,0 +1,198 @@
+#include "PolicyWriter.h"
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+/// <summary>
+/// Default policy writer constructor, starts with no layers
+/// </summary>
+PolicyWriter::PolicyWriter()
+{
+}
+
+PolicyWriter::~PolicyWriter()
+{
+}
+
+/// <summary>
+/// Record how the policy's inputs are encoded so a runtime can build them
+/// </summary>
+void PolicyWriter::setObservation(int observation, int viewRadius)
+{
+	m_observation = observation;
+	m_viewRadius = viewRadius;
+}
+
+/// <summary>
+/// Append a fully connected layer
+/// </summary>
+/// <param name="weights">inputs * outputs values, W[input * outputs + output]</param>
+/// <param name="biases">outputs values</param>
+bool PolicyWriter::addDense(int inputs, int outputs, const float * weights, const float * biases)
+{
+	PolicyRuntime::LayerHeader layer = {};
+	layer.type = QLCPolicyDense;
+	layer.inChannels = inputs;
+	layer.inHeight = 1;
+	layer.inWidth = 1;
+	layer.outChannels = outputs;
+	layer.outHeight = 1;
+	layer.outWidth = 1;
+	return addLayer(layer, weights, (size_t)inputs * outputs, biases, outputs);
+}
+
+/// <summary>
+/// Append a valid convolution with stride 1 of a square kernel
+/// </summary>
+/// <param name="weights">outChannels * inChannels * kernel * kernel values</param>
+/// <param name="biases">outChannels values</param>
+bool PolicyWriter::addConv(int inChannels, int inHeight, int inWidth, int outChannels, int kernel, const float * weights, const float * biases)
+{
+	if (kernel <= 0 || kernel > inHeight || kernel > inWidth)
+		return false;
+	PolicyRuntime::LayerHeader layer = {};
+	layer.type = QLCPolicyConv;
+	layer.inChannels = inChannels;
+	layer.inHeight = inHeight;
+	layer.inWidth = inWidth;
+	layer.outChannels = outChannels;
+	layer.outHeight = inHeight - kernel + 1;
+	layer.outWidth = inWidth - kernel + 1;
+	layer.kernel = kernel;
+	return addLayer(layer, weights, (size_t)outChannels * inChannels * kernel * kernel, biases, outChannels);
+}
+
+/// <summary>
+/// Append an activation over the previous layer's output
+/// </summary>
+bool PolicyWriter::addActivation(QLCPolicyLayer type)
+{
+	if (m_layers.empty() || (type != QLCPolicyRelu && type != QLCPolicySoftmax))
+		return false;
+	PolicyRuntime::LayerHeader layer = {};
+	layer.type = type;
+	layer.inChannels = layer.outChannels = m_layers.back().outChannels;
+	layer.inHeight = layer.outHeight = m_layers.back().outHeight;
+	layer.inWidth = layer.outWidth = m_layers.back().outWidth;
+	return addLayer(layer, nullptr, 0, nullptr, 0);
+}
+
+/// <summary>
+/// Append every layer of a trained model. Only the layers the DQN is built from are supported,
+/// fully connected, valid stride 1 convolutions, relu and softmax
+/// </summary>
+/// <returns>If every layer could be exported</returns>
+bool PolicyWriter::addModel(mw::Model & model)
+{
+	for (size_t i = 0; i < model.depth(); ++i) {
+		std::string type = model[i]->layer_type();
+		auto weights = model[i]->weights();
+		auto in = model[i]->in_shape()[0];
+		auto out = model[i]->out_shape()[0];
+		bool added = false;
+		if (type.find("fully") != std::string::npos && weights.size() == 2) {
+			added = addDense((int)in.size(), (int)out.size(), weights[0]->data(), weights[1]->data());
+		}
+		else if (type.find("conv") != std::string::npos && weights.size() == 2) {
+			int kernel = (int)(in.width_ - out.width_ + 1);
+			// Anything but a valid stride 1 convolution has a different weight count or output size
+			if (weights[0]->size() == in.depth_ * out.depth_ * kernel * kernel && out.height_ == in.height_ - kernel + 1)
+				added = addConv((int)in.depth_, (int)in.height_, (int)in.width_, (int)out.depth_, kernel, weights[0]->data(), weights[1]->data());
+		}
+		else if (type.find("relu") != std::string::npos) {
+			added = addActivation(QLCPolicyRelu);
+		}
+		else if (type.find("softmax") != std::string::npos) {
+			added = addActivation(QLCPolicySoftmax);
+		}
+		if (!added) {
+			std::cout << "Policy export does not support layer " << i << " (" << type << ")" << std::endl;
+			return false;
+		}
+	}
+	return !m_layers.empty();
+}
+
+/// <summary>
+/// Set the int8 input scale of every layer, as PolicyRuntime::calibrate finds them
+/// </summary>
+/// <returns>If there was a scale for every layer</returns>
+bool PolicyWriter::setInputScales(const std::vector<float> & scales)
+{
+	if (scales.size() != m_layers.size())
+		return false;
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		m_layers[i].inputScale = scales[i];
+	}
+	return true;
+}
+
+/// <summary>
+/// Write the policy file, every layer's weights starting on a PolicyRuntime::ALIGNMENT boundary
+/// </summary>
+bool PolicyWriter::save(const std::string & path) const
+{
+	if (m_layers.empty())
+		return false;
+	const uint64_t alignment = PolicyRuntime::ALIGNMENT;
+	auto align = [alignment](uint64_t offset) { return (offset + alignment - 1) / alignment * alignment; };
+
+	std::vector<PolicyRuntime::LayerHeader> layers = m_layers;
+	uint64_t offset = align(sizeof(PolicyRuntime::FileHeader) + layers.size() * sizeof(PolicyRuntime::LayerHeader));
+	for (size_t i = 0; i < layers.size(); ++i) {
+		layers[i].weightOffset = m_weights[i].empty() ? 0 : offset;
+		offset = align(offset + m_weights[i].size() * sizeof(float));
+	}
+	std::vector<char> buffer(offset, 0);
+
+	auto & first = layers.front();
+	auto & last = layers.back();
+	PolicyRuntime::FileHeader header = {};
+	header.magic = PolicyRuntime::MAGIC;
+	header.version = PolicyRuntime::VERSION;
+	header.layerCount = (uint32_t)layers.size();
+	header.inputs = first.inChannels * first.inHeight * first.inWidth;
+	header.outputs = last.outChannels * last.outHeight * last.outWidth;
+	header.observation = m_observation;
+	header.viewRadius = m_viewRadius;
+	memcpy(&buffer[0], &header, sizeof(header));
+	memcpy(&buffer[sizeof(header)], layers.data(), layers.size() * sizeof(PolicyRuntime::LayerHeader));
+	for (size_t i = 0; i < layers.size(); ++i) {
+		if (!m_weights[i].empty())
+			memcpy(&buffer[layers[i].weightOffset], m_weights[i].data(), m_weights[i].size() * sizeof(float));
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	file.write(buffer.data(), buffer.size());
+	return (bool)file;
+}
+
+int PolicyWriter::getLayerCount() const
+{
+	return (int)m_layers.size();
+}
+
+/// <summary>
+/// Append a layer once it is known to take the previous layer's output
+/// </summary>
+bool PolicyWriter::addLayer(PolicyRuntime::LayerHeader layer, const float * weights, size_t weightCount, const float * biases, size_t biasCount)
+{
+	uint64_t inSize = (uint64_t)layer.inChannels * layer.inHeight * layer.inWidth;
+	if (inSize == 0)
+		return false;
+	if (!m_layers.empty()) {
+		auto & previous = m_layers.back();
+		if ((uint64_t)previous.outChannels * previous.outHeight * previous.outWidth != inSize)
+			return false;
+	}
+	std::vector<float> values;
+	values.reserve(weightCount + biasCount);
+	values.insert(values.end(), weights, weights + weightCount);
+	values.insert(values.end(), biases, biases + biasCount);
+	layer.weightCount = values.size();
+	m_layers.push_back(layer);
+	m_weights.push_back(std::move(values));
+	return true;
+}
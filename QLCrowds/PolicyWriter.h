@@ -0,0 +1,37 @@
+#ifndef POLICYWRITER_H
+#define POLICYWRITER_H
+
+#include <string>
+#include <vector>
+
+#include "PolicyRuntime.h"
+#include "ModelWeights.h"
+
+/// <summary>
+/// Builds a policy file for the PolicyRuntime, either layer by layer or from a trained tiny_dnn model.
+/// Layers are checked to feed each other as they are added, the file is written in one go by save.
+/// </summary>
+class PolicyWriter {
+public:
+	PolicyWriter();
+	~PolicyWriter();
+
+	void setObservation(int observation, int viewRadius);
+	bool addDense(int inputs, int outputs, const float * weights, const float * biases);
+	bool addConv(int inChannels, int inHeight, int inWidth, int outChannels, int kernel, const float * weights, const float * biases);
+	bool addActivation(QLCPolicyLayer type);
+	bool addModel(mw::Model & model);
+	bool setInputScales(const std::vector<float> & scales);
+	bool save(const std::string & path) const;
+
+	int getLayerCount() const;
+private:
+	int m_observation = 0;
+	int m_viewRadius = 0;
+	std::vector<PolicyRuntime::LayerHeader> m_layers;
+	std::vector<std::vector<float>> m_weights;	// Weights then biases of every layer
+
+	bool addLayer(PolicyRuntime::LayerHeader layer, const float * weights, size_t weightCount, const float * biases, size_t biasCount);
+};
+
+#endif //!POLICYWRITER_H
@@ -0,0 +1,679 @@
+#include "QTable.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/// <summary>
+/// Default Q table constructor, empty until resized
+/// </summary>
+QTable::QTable()
+{
+}
+
+/// <summary>
+/// Q table deconstructor
+/// </summary>
+QTable::~QTable()
+{
+}
+
+/// <summary>
+/// Resize the table to the given dimensions with every value set to 0
+/// </summary>
+/// <param name="rows">Number of state rows</param>
+/// <param name="cols">Number of state columns</param>
+/// <param name="actions">Number of actions per state</param>
+void QTable::resize(int rows, int cols, int actions)
+{
+	m_rows = rows;
+	m_cols = cols;
+	m_actions = actions;
+	m_hashStates.clear();
+	m_hashSlots.clear();
+	m_slotStates.clear();
+	allocateSlots(0);
+	if (m_storage == QLCQSparse) {
+		m_hashStates.assign(64, -1);
+		m_hashSlots.assign(64, -1);
+	}
+	else {
+		allocateSlots(rows * cols);
+	}
+}
+
+/// <summary>
+/// Change the storage precision converting any stored values
+/// </summary>
+/// <param name="precision">The new storage precision</param>
+void QTable::setPrecision(QLCQPrecision precision)
+{
+	if (precision == m_precision)
+		return;
+	int numSlots = m_numSlots;
+	std::vector<float> values(numSlots * m_actions);
+	for (int slot = 0; slot < numSlots; ++slot) {
+		for (int a = 0; a < m_actions; ++a) {
+			values[slot * m_actions + a] = slotValue(slot, a);
+		}
+	}
+	m_precision = precision;
+	allocateSlots(numSlots);
+	std::fill(m_greedy.begin(), m_greedy.end(), 0);
+	for (int slot = 0; slot < numSlots; ++slot) {
+		for (int a = 0; a < m_actions; ++a) {
+			setSlotValue(slot, a, values[slot * m_actions + a]);
+		}
+	}
+}
+
+/// <summary>
+/// Get the storage precision
+/// </summary>
+QLCQPrecision QTable::getPrecision() const
+{
+	return m_precision;
+}
+
+/// <summary>
+/// Change between dense and sparse storage keeping the stored values.
+/// Rows are moved in their encoded form so no precision is lost, moving to sparse storage only keeps rows for
+/// states that have a non zero value.
+/// </summary>
+/// <param name="storage">The new storage layout</param>
+void QTable::setStorage(QLCQStorage storage)
+{
+	if (storage == m_storage)
+		return;
+	std::vector<int> states;
+	std::vector<int> slots;
+	for (int slot = 0; slot < m_numSlots; ++slot) {
+		bool used = false;
+		for (int a = 0; a < m_actions; ++a) {
+			used |= slotValue(slot, a) != 0.f;
+		}
+		if (used) {
+			states.push_back(m_storage == QLCQSparse ? m_slotStates[slot] : slot);
+			slots.push_back(slot);
+		}
+	}
+	std::vector<float> f32;
+	std::vector<uint16_t> f16;
+	std::vector<int8_t> i8;
+	std::vector<float> scale;
+	std::vector<uint8_t> greedy;
+	f32.swap(m_f32);
+	f16.swap(m_f16);
+	i8.swap(m_i8);
+	scale.swap(m_scale);
+	greedy.swap(m_greedy);
+
+	m_storage = storage;
+	resize(m_rows, m_cols, m_actions);
+	for (size_t i = 0; i < states.size(); ++i) {
+		int slot = acquireSlot(states[i]);
+		int from = slots[i] * m_actions;
+		int to = slot * m_actions;
+		switch (m_precision)
+		{
+		case QLCQFloat16:
+			std::copy(f16.begin() + from, f16.begin() + from + m_actions, m_f16.begin() + to);
+			break;
+		case QLCQInt8:
+			std::copy(i8.begin() + from, i8.begin() + from + m_actions, m_i8.begin() + to);
+			m_scale[slot] = scale[slots[i]];
+			break;
+		default:
+			std::copy(f32.begin() + from, f32.begin() + from + m_actions, m_f32.begin() + to);
+			break;
+		}
+		m_greedy[slot] = greedy[slots[i]];
+	}
+}
+
+/// <summary>
+/// Get the storage layout
+/// </summary>
+QLCQStorage QTable::getStorage() const
+{
+	return m_storage;
+}
+
+/// <summary>
+/// Set every value in the table to 0, sparse storage also releases every row
+/// </summary>
+void QTable::clear()
+{
+	if (m_storage == QLCQSparse) {
+		resize(m_rows, m_cols, m_actions);
+		return;
+	}
+	std::fill(m_f32.begin(), m_f32.end(), 0.f);
+	std::fill(m_f16.begin(), m_f16.end(), 0);
+	std::fill(m_i8.begin(), m_i8.end(), 0);
+	std::fill(m_scale.begin(), m_scale.end(), 0.f);
+	std::fill(m_greedy.begin(), m_greedy.end(), 0);
+}
+
+/// <summary>
+/// Get the value of an action in a state decoded to fp32, unwritten sparse states are 0
+/// </summary>
+float QTable::get(int row, int col, int action) const
+{
+	int slot = findSlot(stateIndex(row, col));
+	if (slot < 0)
+		return 0.f;
+	return slotValue(slot, action);
+}
+
+/// <summary>
+/// Set the value of an action in a state.
+/// In int8 mode the state scale grows to fit the value, requantizing the other actions of the state.
+/// </summary>
+void QTable::set(int row, int col, int action, float value)
+{
+	setSlotValue(acquireSlot(stateIndex(row, col)), action, value);
+}
+
+/// <summary>
+/// Add to the value of an action in a state, the sum is done in fp32
+/// </summary>
+void QTable::add(int row, int col, int action, float delta)
+{
+	set(row, col, action, get(row, col, action) + delta);
+}
+
+/// <summary>
+/// Get the largest action value of a state
+/// </summary>
+float QTable::maxValue(int row, int col) const
+{
+	float best = get(row, col, 0);
+	for (int a = 1; a < m_actions; ++a) {
+		best = std::max(best, get(row, col, a));
+	}
+	return best;
+}
+
+/// <summary>
+/// Get the action with the largest value in a state, ties go to the lowest action index
+/// </summary>
+int QTable::greedyAction(int row, int col) const
+{
+	int slot = findSlot(stateIndex(row, col));
+	if (slot < 0)
+		return 0;
+	return m_greedy[slot];
+}
+
+int QTable::getRows() const
+{
+	return m_rows;
+}
+
+int QTable::getCols() const
+{
+	return m_cols;
+}
+
+int QTable::getActions() const
+{
+	return m_actions;
+}
+
+/// <summary>
+/// Get the number of states with a row of values, every state in dense storage
+/// </summary>
+int QTable::getStoredStates() const
+{
+	return m_numSlots;
+}
+
+/// <summary>
+/// Get the number of bytes used to store the values
+/// </summary>
+size_t QTable::memoryUsage() const
+{
+	return m_f32.size() * sizeof(float) + m_f16.size() * sizeof(uint16_t) + m_i8.size() * sizeof(int8_t) + m_scale.size() * sizeof(float)
+		+ m_greedy.size() * sizeof(uint8_t)
+		+ (m_hashStates.size() + m_hashSlots.size() + m_slotStates.size()) * sizeof(int32_t);
+}
+
+/// <summary>
+/// Append the table dimensions, precision, storage and raw rows to a buffer.
+/// Sparse tables also write the state index of every row.
+/// </summary>
+/// <param name="out">The buffer to append to</param>
+void QTable::serialize(std::vector<char> & out) const
+{
+	int32_t header[6] = { m_rows, m_cols, m_actions, m_precision, m_storage, m_numSlots };
+	size_t keyBytes = m_storage == QLCQSparse ? m_slotStates.size() * sizeof(int32_t) : 0;
+	size_t valueBytes = m_f32.size() * sizeof(float) + m_f16.size() * sizeof(uint16_t) + m_i8.size() * sizeof(int8_t);
+	size_t scaleBytes = m_scale.size() * sizeof(float);
+	size_t offset = out.size();
+	out.resize(offset + sizeof(header) + keyBytes + valueBytes + scaleBytes);
+	char * dst = &out[offset];
+	memcpy(dst, header, sizeof(header));
+	dst += sizeof(header);
+	if (keyBytes) {
+		memcpy(dst, m_slotStates.data(), keyBytes);
+		dst += keyBytes;
+	}
+	switch (m_precision)
+	{
+	case QLCQFloat16:
+		memcpy(dst, m_f16.data(), valueBytes);
+		break;
+	case QLCQInt8:
+		memcpy(dst, m_i8.data(), valueBytes);
+		memcpy(dst + valueBytes, m_scale.data(), scaleBytes);
+		break;
+	default:
+		memcpy(dst, m_f32.data(), valueBytes);
+		break;
+	}
+}
+
+/// <summary>
+/// Replace the table with serialized data, the precision and storage are taken from the data
+/// </summary>
+/// <param name="data">Pointer to data written by serialize</param>
+/// <param name="size">Number of bytes available</param>
+/// <returns>If the data was valid and loaded</returns>
+bool QTable::deserialize(const char * data, size_t size)
+{
+	int32_t header[6];
+	if (size < sizeof(header))
+		return false;
+	memcpy(header, data, sizeof(header));
+	int rows = header[0];
+	int cols = header[1];
+	int actions = header[2];
+	QLCQPrecision precision = header[3];
+	QLCQStorage storage = header[4];
+	int numSlots = header[5];
+	if (rows < 0 || cols < 0 || actions < 0 || precision < QLCQFloat32 || precision > QLCQInt8
+		|| storage < QLCQDense || storage > QLCQSparse || numSlots < 0 || numSlots > rows * cols
+		|| (storage == QLCQDense && numSlots != rows * cols))
+		return false;
+	size_t keyBytes = storage == QLCQSparse ? numSlots * sizeof(int32_t) : 0;
+	size_t count = (size_t)numSlots * actions;
+	size_t valueBytes = count * (precision == QLCQFloat16 ? sizeof(uint16_t) : precision == QLCQInt8 ? sizeof(int8_t) : sizeof(float));
+	size_t scaleBytes = precision == QLCQInt8 ? numSlots * sizeof(float) : 0;
+	if (size < sizeof(header) + keyBytes + valueBytes + scaleBytes)
+		return false;
+
+	// Every key is checked before the table is touched, bad data leaves it as it was
+	const char * src = data + sizeof(header);
+	std::vector<int32_t> keys(keyBytes ? numSlots : 0);
+	if (keyBytes) {
+		std::vector<unsigned char> seen(rows * cols, 0);
+		memcpy(keys.data(), src, keyBytes);
+		for (int32_t state : keys) {
+			if (state < 0 || state >= rows * cols || seen[state])
+				return false;
+			seen[state] = 1;
+		}
+		src += keyBytes;
+	}
+
+	m_precision = precision;
+	m_storage = storage;
+	resize(rows, cols, actions);
+	for (int32_t state : keys) {
+		acquireSlot(state);
+	}
+	switch (m_precision)
+	{
+	case QLCQFloat16:
+		memcpy(m_f16.data(), src, valueBytes);
+		break;
+	case QLCQInt8:
+		memcpy(m_i8.data(), src, valueBytes);
+		memcpy(m_scale.data(), src + valueBytes, scaleBytes);
+		break;
+	default:
+		memcpy(m_f32.data(), src, valueBytes);
+		break;
+	}
+	for (int slot = 0; slot < m_numSlots; ++slot) {
+		rescanGreedy(slot);
+	}
+	return true;
+}
+
+int QTable::stateIndex(int row, int col) const
+{
+	return row * m_cols + col;
+}
+
+/// <summary>
+/// Find the row slot of a state
+/// </summary>
+/// <returns>The slot or -1 if a sparse table has no row for the state</returns>
+int QTable::findSlot(int state) const
+{
+	if (m_storage == QLCQDense)
+		return state;
+	uint32_t mask = m_hashStates.size() - 1;
+	for (uint32_t bucket = (state * 2654435761u) & mask;; bucket = (bucket + 1) & mask) {
+		if (m_hashStates[bucket] == state)
+			return m_hashSlots[bucket];
+		if (m_hashStates[bucket] < 0)
+			return -1;
+	}
+}
+
+/// <summary>
+/// Find the row slot of a state, giving a sparse table a new zeroed row on the first write
+/// </summary>
+int QTable::acquireSlot(int state)
+{
+	if (m_storage == QLCQDense)
+		return state;
+	int slot = findSlot(state);
+	if (slot >= 0)
+		return slot;
+	// Keep the load factor at or below a half so probes stay short
+	if ((m_numSlots + 1) * 2 > (int)m_hashStates.size())
+		growHash();
+	slot = m_numSlots;
+	uint32_t mask = m_hashStates.size() - 1;
+	uint32_t bucket = (state * 2654435761u) & mask;
+	while (m_hashStates[bucket] >= 0) {
+		bucket = (bucket + 1) & mask;
+	}
+	m_hashStates[bucket] = state;
+	m_hashSlots[bucket] = slot;
+	m_slotStates.push_back(state);
+	allocateSlots(m_numSlots + 1);
+	return slot;
+}
+
+/// <summary>
+/// Double the hash capacity and reinsert every stored state
+/// </summary>
+void QTable::growHash()
+{
+	size_t capacity = m_hashStates.size() * 2;
+	m_hashStates.assign(capacity, -1);
+	m_hashSlots.assign(capacity, -1);
+	uint32_t mask = capacity - 1;
+	for (int slot = 0; slot < (int)m_slotStates.size(); ++slot) {
+		uint32_t bucket = (m_slotStates[slot] * 2654435761u) & mask;
+		while (m_hashStates[bucket] >= 0) {
+			bucket = (bucket + 1) & mask;
+		}
+		m_hashStates[bucket] = m_slotStates[slot];
+		m_hashSlots[bucket] = slot;
+	}
+}
+
+/// <summary>
+/// Size the row storage for the current precision, existing rows keep their raw values and new rows are 0
+/// </summary>
+/// <param name="count">Number of row slots</param>
+void QTable::allocateSlots(int count)
+{
+	m_numSlots = count;
+	size_t values = (size_t)count * m_actions;
+	m_f32.resize(m_precision == QLCQFloat32 ? values : 0, 0.f);
+	m_f16.resize(m_precision == QLCQFloat16 ? values : 0, 0);
+	m_i8.resize(m_precision == QLCQInt8 ? values : 0, 0);
+	m_scale.resize(m_precision == QLCQInt8 ? count : 0, 0.f);
+	m_greedy.resize(count, 0);
+	if (count == 0) {
+		// Release the memory of a cleared table
+		std::vector<float>().swap(m_f32);
+		std::vector<uint16_t>().swap(m_f16);
+		std::vector<int8_t>().swap(m_i8);
+		std::vector<float>().swap(m_scale);
+		std::vector<uint8_t>().swap(m_greedy);
+	}
+}
+
+/// <summary>
+/// Decode the value of an action in a row slot
+/// </summary>
+float QTable::slotValue(int slot, int action) const
+{
+	int index = slot * m_actions + action;
+	switch (m_precision)
+	{
+	case QLCQFloat16:
+		return halfToFloat(m_f16[index]);
+	case QLCQInt8:
+		return m_i8[index] * m_scale[slot];
+	default:
+		return m_f32[index];
+	}
+}
+
+/// <summary>
+/// Encode the value of an action in a row slot and keep the greedy map up to date
+/// </summary>
+void QTable::setSlotValue(int slot, int action, float value)
+{
+	int index = slot * m_actions + action;
+	float oldValue = slotValue(slot, action);
+	switch (m_precision)
+	{
+	case QLCQFloat16:
+		m_f16[index] = roundHalf(value);
+		break;
+	case QLCQInt8: {
+		float scale = m_scale[slot];
+		if (fabsf(value) > scale * 127.f) {
+			rescale(slot, fabsf(value) / 127.f);
+			m_i8[index] = quantize(value, m_scale[slot]);
+			// Every action of the state was requantized
+			rescanGreedy(slot);
+			return;
+		}
+		m_i8[index] = quantize(value, scale);
+		break;
+	}
+	default:
+		m_f32[index] = value;
+		break;
+	}
+	// Compare the stored values so the map agrees with what get returns
+	updateGreedy(slot, action, oldValue, slotValue(slot, action));
+}
+
+/// <summary>
+/// Update the greedy action of a state after one of its values changed.
+/// A value rising past the best takes over, only a drop in the greedy action's own value needs a rescan.
+/// </summary>
+/// <param name="slot">Row slot of the state</param>
+/// <param name="action">The action that changed</param>
+/// <param name="oldValue">The stored value before the change</param>
+/// <param name="newValue">The stored value after the change</param>
+void QTable::updateGreedy(int slot, int action, float oldValue, float newValue)
+{
+	int greedy = m_greedy[slot];
+	if (action == greedy) {
+		if (newValue < oldValue) {
+			if (m_precision == QLCQInt8)
+				shrinkScale(slot);
+			rescanGreedy(slot);
+		}
+		return;
+	}
+	float best = slotValue(slot, greedy);
+	if (newValue > best || (newValue == best && action < greedy))
+		m_greedy[slot] = action;
+}
+
+/// <summary>
+/// Recompute the greedy action of a state from its values
+/// </summary>
+void QTable::rescanGreedy(int slot)
+{
+	int bestAction = 0;
+	float best = slotValue(slot, 0);
+	for (int a = 1; a < m_actions; ++a) {
+		float value = slotValue(slot, a);
+		if (value > best) {
+			best = value;
+			bestAction = a;
+		}
+	}
+	m_greedy[slot] = bestAction;
+}
+
+/// <summary>
+/// Requantize every action of an int8 state to a new scale
+/// </summary>
+void QTable::rescale(int slot, float newScale)
+{
+	float scale = m_scale[slot];
+	int8_t * actions = &m_i8[slot * m_actions];
+	for (int a = 0; a < m_actions; ++a) {
+		actions[a] = quantize(actions[a] * scale, newScale);
+	}
+	m_scale[slot] = newScale;
+}
+
+/// <summary>
+/// Fit an int8 state's scale back to its largest value once that has fallen below half the range.
+/// The scale grows with the largest value written, without this a state that once held a large value
+/// would keep a coarse step after its values settled.
+/// </summary>
+void QTable::shrinkScale(int slot)
+{
+	const int8_t * actions = &m_i8[slot * m_actions];
+	int largest = 0;
+	for (int a = 0; a < m_actions; ++a) {
+		largest = std::max(largest, abs(actions[a]));
+	}
+	// Only worth the requantization noise once it gains at least a bit of precision
+	if (largest * 2 < 127)
+		rescale(slot, largest * m_scale[slot] / 127.f);
+}
+
+/// <summary>
+/// A uniform value in [0, 1) for stochastic rounding, xorshift32 as it is cheap
+/// </summary>
+float QTable::roundingNoise()
+{
+	m_roundState ^= m_roundState << 13;
+	m_roundState ^= m_roundState >> 17;
+	m_roundState ^= m_roundState << 5;
+	return (m_roundState >> 8) * (1.f / 16777216.f);
+}
+
+/// <summary>
+/// Quantize a value to int8 with stochastic rounding.
+/// Learning updates are often smaller than one quantization step, rounding to nearest would drop them entirely
+/// while stochastic rounding keeps them correct in expectation.
+/// </summary>
+/// <param name="value">The value to quantize</param>
+/// <param name="scale">The state scale factor</param>
+/// <returns>The quantized value</returns>
+int8_t QTable::quantize(float value, float scale)
+{
+	if (scale <= 0.f)
+		return 0;
+	float quantized = floorf(value / scale + roundingNoise());
+	return (int8_t)std::max(-127.f, std::min(127.f, quantized));
+}
+
+/// <summary>
+/// Convert a float to IEEE half precision with stochastic rounding, for the same reason as quantize.
+/// Near |Q| = 100 a half step is 0.0625 so round to nearest would drop any update below 0.031.
+/// </summary>
+/// <param name="value">The value to store</param>
+/// <returns>One of the two halves either side of the value, the nearer one more likely</returns>
+uint16_t QTable::roundHalf(float value)
+{
+	uint16_t half = floatToHalf(value);
+	uint16_t magnitude = half & 0x7fff;
+	if (magnitude >= 0x7c00)
+		return half;	// Inf, NaN or out of range
+	float target = fabsf(value);
+	float nearest = halfToFloat(magnitude);
+	if (nearest == target)
+		return half;
+	// Half magnitudes are ordered as their bit patterns, the next pattern is the next value up
+	uint16_t lower = nearest > target ? magnitude - 1 : magnitude;
+	float low = halfToFloat(lower);
+	float high = halfToFloat(lower + 1);
+	if (roundingNoise() < (target - low) / (high - low))
+		lower++;
+	return (half & 0x8000) | lower;
+}
+
+/// <summary>
+/// Convert a float to IEEE half precision rounding to nearest even
+/// </summary>
+uint16_t QTable::floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		// Inf or NaN
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	}
+	if (exponent >= 31) {
+		// Overflow to infinity
+		return sign | 0x7c00;
+	}
+	if (exponent <= 0) {
+		// Subnormal or zero
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return sign | half;
+	}
+	uint32_t half = (exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;	// A carry into the exponent still gives the correct rounded value
+	return sign | half;
+}
+
+/// <summary>
+/// Convert an IEEE half precision value to a float
+/// </summary>
+float QTable::halfToFloat(uint16_t value)
+{
+	uint32_t sign = (value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		}
+		else {
+			// Normalise the subnormal
+			exponent = 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			mantissa &= 0x3ff;
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+	}
+	else if (exponent == 31) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else {
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
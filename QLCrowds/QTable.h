@@ -0,0 +1,104 @@
+#ifndef QTABLE_H
+#define QTABLE_H
+
+#include <vector>
+#include <stdint.h>
+
+typedef int QLCQPrecision;
+/// <summary>
+/// Storage precision of a Q table
+/// </summary>
+enum QLCQPrecision_ {
+	QLCQFloat32 = 0,
+	QLCQFloat16 = 1,
+	QLCQInt8 = 2
+};
+
+typedef int QLCQStorage;
+/// <summary>
+/// Layout of the states in a Q table
+/// </summary>
+enum QLCQStorage_ {
+	QLCQDense = 0,		// A row of values for every state
+	QLCQSparse = 1		// Rows only for states that have been written, found through a hash of the state index
+};
+
+/// <summary>
+/// Tabular action values for a grid of states stored contiguously, one block of actions per state.
+/// Values can be stored as fp32, fp16 or int8 with a per state scale factor to cut memory, fp16 and int8 writes
+/// round stochastically so updates smaller than a step still count on average.
+/// All reads decode to fp32 and all writes encode from fp32 so learning arithmetic stays in full precision.
+/// The greedy action of every state is kept in a one byte per state map updated on each write, a state is only
+/// rescanned when its greedy action's value drops.
+/// In sparse storage a state gets its row on the first write and unwritten states read as 0, so memory follows
+/// the number of states explored rather than the size of the grid.
+/// </summary>
+class QTable {
+public:
+	QTable();
+	~QTable();
+
+	void resize(int rows, int cols, int actions);
+	void setPrecision(QLCQPrecision precision);
+	QLCQPrecision getPrecision() const;
+	void setStorage(QLCQStorage storage);
+	QLCQStorage getStorage() const;
+	void clear();
+
+	float get(int row, int col, int action) const;
+	void set(int row, int col, int action, float value);
+	void add(int row, int col, int action, float delta);
+	float maxValue(int row, int col) const;
+	int greedyAction(int row, int col) const;
+
+	int getRows() const;
+	int getCols() const;
+	int getActions() const;
+	int getStoredStates() const;
+	size_t memoryUsage() const;
+
+	// Checkpointing, the raw storage is written as is so loading is a straight copy
+	void serialize(std::vector<char> & out) const;
+	bool deserialize(const char * data, size_t size);
+private:
+	int m_rows = 0;
+	int m_cols = 0;
+	int m_actions = 0;
+	QLCQPrecision m_precision = QLCQFloat32;
+	QLCQStorage m_storage = QLCQDense;
+
+	// Rows of values, indexed by slot. In dense storage the slot of a state is its index
+	std::vector<float> m_f32;
+	std::vector<uint16_t> m_f16;
+	std::vector<int8_t> m_i8;
+	std::vector<float> m_scale;		// Per state int8 scale, value = quantized * scale
+	std::vector<uint8_t> m_greedy;	// Greedy action of each state, ties go to the lowest action index
+	int m_numSlots = 0;
+	uint32_t m_roundState = 0x9E3779B9u;
+
+	// Sparse storage, open addressing with linear probing from state index to slot
+	std::vector<int32_t> m_hashStates;	// -1 for an empty bucket
+	std::vector<int32_t> m_hashSlots;
+	std::vector<int32_t> m_slotStates;	// State index of each slot
+
+	int stateIndex(int row, int col) const;
+	int findSlot(int state) const;
+	int acquireSlot(int state);
+	void growHash();
+	void allocateSlots(int count);
+
+	float slotValue(int slot, int action) const;
+	void setSlotValue(int slot, int action, float value);
+	void updateGreedy(int slot, int action, float oldValue, float newValue);
+	void rescanGreedy(int slot);
+	void rescale(int slot, float newScale);
+	void shrinkScale(int slot);
+
+	float roundingNoise();
+	int8_t quantize(float value, float scale);
+	uint16_t roundHalf(float value);
+	static uint16_t floatToHalf(float value);
+	static float halfToFloat(uint16_t value);
+};
+
+#endif //!QTABLE_H
@@ -0,0 +1,178 @@
+#ifndef REPLAYBUFFER_H
+#define REPLAYBUFFER_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include "SumTree.h"
+
+/// <summary>
+/// Fixed capacity experience replay stored contiguously as a ring, once full every push overwrites the oldest entry.
+/// Sampling touches only the drawn entries. Without replacement it runs a partial Fisher-Yates shuffle over a
+/// permutation of the stored slots that is kept between calls, so a batch costs O(batch) and never copies the buffer.
+/// Prioritized sampling draws slots in proportion to (|TD error| + epsilon)^alpha through a sum tree and returns the
+/// importance sampling weight of each draw, normalized by the largest in the batch. New entries get the largest
+/// priority seen so far so every memory is replayed at least once before its error is known.
+/// Nothing is allocated until the first push and storage then grows with the entries, so a buffer that is never
+/// used, such as a tabular agent's, costs only the object itself.
+/// </summary>
+template <typename T>
+class ReplayBuffer {
+public:
+	float m_alpha = 0.6f;			// How strongly priorities skew sampling, 0 is uniform
+	float m_beta = 0.4f;			// Importance sampling correction, 1 fully corrects the skew
+	float m_betaIncrement = 0.0001f;	// Beta moves towards 1 by this much every prioritized batch
+	float m_priorityEpsilon = 0.01f;	// Keeps memories with no error drawable
+
+	explicit ReplayBuffer(size_t capacity = 1000, unsigned int seed = 0) :
+		m_generator(seed)
+	{
+		setCapacity(capacity);
+	}
+
+	/// <summary>
+	/// Change the capacity, this drops everything stored
+	/// </summary>
+	void setCapacity(size_t capacity)
+	{
+		m_capacity = capacity > 0 ? capacity : 1;
+		clear();
+	}
+
+	void seed(unsigned int seed)
+	{
+		m_generator.seed(seed);
+	}
+
+	/// <summary>
+	/// Drop every entry and release the storage
+	/// </summary>
+	void clear()
+	{
+		std::vector<T>().swap(m_data);
+		std::vector<size_t>().swap(m_order);
+		m_next = 0;
+		m_priorities.resize(0);
+		m_maxPriority = 1.f;
+	}
+
+	/// <summary>
+	/// Store an entry, replacing the oldest when the buffer is full
+	/// </summary>
+	void push(const T & value)
+	{
+		size_t slot = m_next;
+		if (m_data.size() < m_capacity) {
+			if (m_data.size() == m_data.capacity())
+				grow();
+			slot = m_data.size();
+			m_order.push_back(slot);
+			m_data.push_back(value);
+		}
+		else {
+			m_data[slot] = value;
+		}
+		m_priorities.set(slot, m_maxPriority);
+		m_next = (slot + 1) % m_capacity;
+	}
+
+	/// <summary>
+	/// Draw count entries into out, with replacement entries may repeat.
+	/// Without replacement count is clamped to the number stored.
+	/// </summary>
+	void sample(size_t count, std::vector<const T *> & out, bool withReplacement = false)
+	{
+		out.clear();
+		size_t size = m_data.size();
+		if (size == 0)
+			return;
+		if (withReplacement) {
+			std::uniform_int_distribution<size_t> distr(0, size - 1);
+			for (size_t i = 0; i < count; ++i) {
+				out.push_back(&m_data[distr(m_generator)]);
+			}
+			return;
+		}
+		if (count > size)
+			count = size;
+		for (size_t i = 0; i < count; ++i) {
+			std::uniform_int_distribution<size_t> distr(i, size - 1);
+			std::swap(m_order[i], m_order[distr(m_generator)]);
+			out.push_back(&m_data[m_order[i]]);
+		}
+	}
+
+	/// <summary>
+	/// Draw count entries in proportion to their priority, one from each equal slice of the total priority.
+	/// slots receives where each entry is stored for updatePriority and weights its importance sampling weight.
+	/// </summary>
+	void samplePrioritized(size_t count, std::vector<const T *> & out, std::vector<size_t> & slots, std::vector<float> & weights)
+	{
+		out.clear();
+		slots.clear();
+		weights.clear();
+		size_t size = m_data.size();
+		float total = m_priorities.total();
+		if (size == 0 || total <= 0)
+			return;
+		float segment = total / count;
+		float maxWeight = 0;
+		for (size_t i = 0; i < count; ++i) {
+			std::uniform_real_distribution<float> distr(segment * i, segment * (i + 1));
+			size_t slot = std::min(m_priorities.find(distr(m_generator)), size - 1);
+			float probability = m_priorities.get(slot) / total;
+			float weight = powf(size * probability, -m_beta);
+			maxWeight = std::max(maxWeight, weight);
+			out.push_back(&m_data[slot]);
+			slots.push_back(slot);
+			weights.push_back(weight);
+		}
+		for (auto & weight : weights) {
+			weight /= maxWeight;
+		}
+		m_beta = std::min(1.f, m_beta + m_betaIncrement);
+	}
+
+	/// <summary>
+	/// Set the priority of a stored entry from the magnitude of its latest TD error
+	/// </summary>
+	void updatePriority(size_t slot, float error)
+	{
+		float priority = powf(fabsf(error) + m_priorityEpsilon, m_alpha);
+		m_priorities.set(slot, priority);
+		m_maxPriority = std::max(m_maxPriority, priority);
+	}
+
+	size_t size() const { return m_data.size(); }
+	size_t capacity() const { return m_capacity; }
+	bool empty() const { return m_data.empty(); }
+
+	/// <summary>
+	/// Entries by storage slot, not in insertion order
+	/// </summary>
+	const T & operator[](size_t slot) const { return m_data[slot]; }
+private:
+	std::vector<T> m_data;
+	std::vector<size_t> m_order;	// Permutation of the stored slots, the prefix is the last sample drawn
+	size_t m_capacity = 1;
+	size_t m_next = 0;				// Slot the next push writes once full
+	std::mt19937 m_generator;
+	SumTree m_priorities;			// Priority of every slot
+	float m_maxPriority = 1.f;
+
+	/// <summary>
+	/// Double the storage up to the capacity, the sum tree is sized for the full capacity on the first push
+	/// </summary>
+	void grow()
+	{
+		if (m_data.empty())
+			m_priorities.resize(m_capacity);
+		size_t reserved = std::min(m_capacity, std::max<size_t>(64, m_data.capacity() * 2));
+		m_data.reserve(reserved);
+		m_order.reserve(reserved);
+	}
+};
+
+#endif //!REPLAYBUFFER_H
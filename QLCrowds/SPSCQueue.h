@@ -0,0 +1,77 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <stddef.h>
+
+/// <summary>
+/// Bounded lock free queue for exactly one producer thread and one consumer thread.
+/// The capacity is rounded up to a power of two so positions wrap with a mask. The head and tail
+/// counters are kept a cache line apart by padding so the two threads do not false share, alignas would
+/// need an over aligned heap allocation that new only guarantees from C++17.
+/// </summary>
+template <typename T>
+class SPSCQueue {
+public:
+	static const size_t CACHE_LINE = 64;
+
+	explicit SPSCQueue(size_t capacity = 1024)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		m_buffer.resize(size);
+		m_mask = size - 1;
+	}
+
+	/// <summary>
+	/// Producer side, fails when the queue is full
+	/// </summary>
+	bool tryPush(const T & value)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead > m_mask) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail - m_cachedHead > m_mask)
+				return false;
+		}
+		m_buffer[tail & m_mask] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// Consumer side, fails when the queue is empty
+	/// </summary>
+	bool tryPop(T & value)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail)
+				return false;
+		}
+		value = m_buffer[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t capacity() const { return m_mask + 1; }
+private:
+	std::vector<T> m_buffer;
+	size_t m_mask;
+	char m_sharedPadding[CACHE_LINE];
+
+	// Consumer owned
+	std::atomic<size_t> m_head{ 0 };
+	size_t m_cachedTail = 0;
+	char m_consumerPadding[CACHE_LINE];
+
+	// Producer owned
+	std::atomic<size_t> m_tail{ 0 };
+	size_t m_cachedHead = 0;
+	char m_producerPadding[CACHE_LINE];		// Keeps whatever is allocated next off the producer's line
+};
+
+#endif //!SPSCQUEUE_H
@@ -0,0 +1,15 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Instruction set the vectorized loops are compiled for, the same choice for every file that includes this.
+// QLC_AVX2 when the compiler targets AVX2 with FMA, /arch:AVX2 under MSVC which the x64 configurations set.
+// QLC_SSE for SSE2, which every x64 target and the default x86 MSVC target have. Otherwise the scalar loops run.
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define QLC_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define QLC_SSE
+#endif
+
+#endif //!SIMD_H
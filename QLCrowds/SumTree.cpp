@@ -0,0 +1,89 @@
+#include "SumTree.h"
+#include <algorithm>
+
+/// <summary>
+/// Default sum tree constructor, holds nothing until resized
+/// </summary>
+SumTree::SumTree()
+{
+}
+
+SumTree::~SumTree()
+{
+}
+
+/// <summary>
+/// Size the tree for a number of priorities, all set to 0
+/// </summary>
+void SumTree::resize(size_t capacity)
+{
+	m_capacity = capacity;
+	m_leaves = 1;
+	while (m_leaves < capacity)
+		m_leaves <<= 1;
+	// A fresh vector so shrinking the tree releases its memory
+	std::vector<float>(2 * m_leaves, 0.f).swap(m_nodes);
+}
+
+/// <summary>
+/// Set every priority to 0
+/// </summary>
+void SumTree::clear()
+{
+	std::fill(m_nodes.begin(), m_nodes.end(), 0.f);
+}
+
+/// <summary>
+/// Change one priority and the sums above it
+/// </summary>
+/// <param name="index">The priority to change</param>
+/// <param name="priority">Its new value, must not be negative</param>
+void SumTree::set(size_t index, float priority)
+{
+	size_t node = m_leaves + index;
+	m_nodes[node] = priority;
+	// Recompute rather than add the difference so rounding errors do not build up in the sums
+	for (node >>= 1; node > 0; node >>= 1) {
+		m_nodes[node] = m_nodes[2 * node] + m_nodes[2 * node + 1];
+	}
+}
+
+float SumTree::get(size_t index) const
+{
+	return m_nodes[m_leaves + index];
+}
+
+/// <summary>
+/// Sum of every priority
+/// </summary>
+float SumTree::total() const
+{
+	return m_nodes[1];
+}
+
+/// <summary>
+/// Find the priority a running total falls in, walking down from the root
+/// </summary>
+/// <param name="value">A value in [0, total())</param>
+/// <returns>The index of the priority whose range of the running total holds value</returns>
+size_t SumTree::find(float value) const
+{
+	size_t node = 1;
+	while (node < m_leaves) {
+		float left = m_nodes[2 * node];
+		// A zero weight child is never chosen, even when rounding pushes value onto its boundary
+		if (value < left || m_nodes[2 * node + 1] <= 0) {
+			node = 2 * node;
+		}
+		else {
+			value -= left;
+			node = 2 * node + 1;
+		}
+	}
+	return std::min(node - m_leaves, m_capacity - 1);
+}
+
+size_t SumTree::capacity() const
+{
+	return m_capacity;
+}
@@ -0,0 +1,31 @@
+#ifndef SUMTREE_H
+#define SUMTREE_H
+
+#include <vector>
+#include <stddef.h>
+
+/// <summary>
+/// Binary tree of partial sums over a fixed number of non negative priorities.
+/// Leaves hold the priorities and every parent the sum of its children, so changing a priority and finding
+/// the leaf a running total falls in are both O(log N). Used to draw replay memories in proportion to priority.
+/// </summary>
+class SumTree {
+public:
+	SumTree();
+	~SumTree();
+
+	void resize(size_t capacity);
+	void clear();
+
+	void set(size_t index, float priority);
+	float get(size_t index) const;
+	float total() const;
+	size_t find(float value) const;
+	size_t capacity() const;
+private:
+	size_t m_capacity = 0;
+	size_t m_leaves = 1;			// Capacity rounded up to a power of two, leaf i is node m_leaves + i
+	std::vector<float> m_nodes;		// Node 1 is the root, node 0 is unused
+};
+
+#endif //!SUMTREE_H
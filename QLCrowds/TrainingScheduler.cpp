@@ -0,0 +1,48 @@
+#include "TrainingScheduler.h"
+
+/// <summary>
+/// Default training scheduler constructor
+/// </summary>
+TrainingScheduler::TrainingScheduler()
+{
+}
+
+TrainingScheduler::~TrainingScheduler()
+{
+}
+
+/// <summary>
+/// Start counting from the beginning of the warm up again
+/// </summary>
+void TrainingScheduler::reset()
+{
+	m_environmentSteps = 0;
+	m_gradientSteps = 0;
+	m_credit = 0;
+}
+
+/// <summary>
+/// Record one environment step
+/// </summary>
+/// <returns>The number of gradient steps to run now</returns>
+int TrainingScheduler::step()
+{
+	m_environmentSteps++;
+	if (m_environmentSteps <= m_warmupSteps || m_gradientStepsPerStep <= 0)
+		return 0;
+	m_credit += m_gradientStepsPerStep;
+	int steps = (int)m_credit;
+	m_credit -= steps;
+	m_gradientSteps += steps;
+	return steps;
+}
+
+long long TrainingScheduler::getEnvironmentSteps() const
+{
+	return m_environmentSteps;
+}
+
+long long TrainingScheduler::getGradientSteps() const
+{
+	return m_gradientSteps;
+}
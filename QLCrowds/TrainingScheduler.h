@@ -0,0 +1,28 @@
+#ifndef TRAININGSCHEDULER_H
+#define TRAININGSCHEDULER_H
+
+/// <summary>
+/// Decides how many gradient steps to run for each environment step.
+/// Nothing is trained during the warm up, after it a fractional credit accumulates at the configured ratio so
+/// a ratio of 0.25 trains every fourth step and a ratio of 2 trains twice per step.
+/// </summary>
+class TrainingScheduler {
+public:
+	TrainingScheduler();
+	~TrainingScheduler();
+
+	int m_warmupSteps = 100;			// Environment steps before the first gradient step
+	float m_gradientStepsPerStep = 1.f;	// Gradient steps per environment step after the warm up
+
+	void reset();
+	int step();
+
+	long long getEnvironmentSteps() const;
+	long long getGradientSteps() const;
+private:
+	long long m_environmentSteps = 0;
+	long long m_gradientSteps = 0;
+	double m_credit = 0;
+};
+
+#endif //!TRAININGSCHEDULER_H
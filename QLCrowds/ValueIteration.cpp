@@ -0,0 +1,299 @@
+#include "ValueIteration.h"
+#include "Simd.h"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <math.h>
+
+namespace {
+	const float s_disallowedReward = -1e30f;
+
+	/// <summary>
+	/// Reusable barrier so the row block workers can stay alive between sweeps
+	/// </summary>
+	class SweepBarrier {
+	public:
+		SweepBarrier(int count) : m_count(count), m_waiting(0), m_generation(0) {}
+		void wait() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			int generation = m_generation;
+			if (++m_waiting == m_count) {
+				m_waiting = 0;
+				m_generation++;
+				m_condition.notify_all();
+			}
+			else {
+				m_condition.wait(lock, [&] { return generation != m_generation; });
+			}
+		}
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		int m_count;
+		int m_waiting;
+		int m_generation;
+	};
+}
+
+/// <summary>
+/// Default value iteration constructor
+/// </summary>
+ValueIteration::ValueIteration()
+{
+}
+
+/// <summary>
+/// Value iteration deconstructor
+/// </summary>
+ValueIteration::~ValueIteration()
+{
+}
+
+/// <summary>
+/// Solve for the optimal state values of the environment
+/// </summary>
+/// <param name="env">The environment to solve</param>
+/// <returns>The number of sweeps run</returns>
+int ValueIteration::solve(Environment & env)
+{
+	build(env);
+
+	int numThreads = m_numThreads > 0 ? m_numThreads : std::max(1u, std::thread::hardware_concurrency());
+	// Small grids are not worth the synchronisation cost of a sweep per thread
+	numThreads = std::max(1, std::min(numThreads, m_rows / 16));
+	int rowsPerBlock = (m_rows + numThreads - 1) / numThreads;
+
+	std::vector<float> blockDeltas(numThreads, 0.f);
+	SweepBarrier barrier(numThreads);
+	bool finished = false;
+	int sweeps = 0;
+
+	auto worker = [&](int block) {
+		int begin = block * rowsPerBlock;
+		int end = std::min(m_rows, begin + rowsPerBlock);
+		while (true) {
+			blockDeltas[block] = sweepRows(begin, end);
+			barrier.wait();
+			if (block == 0) {
+				float delta = *std::max_element(blockDeltas.begin(), blockDeltas.end());
+				m_current = 1 - m_current;
+				sweeps++;
+				finished = delta < m_tolerance || sweeps >= m_maxSweeps;
+			}
+			barrier.wait();
+			if (finished)
+				break;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int block = 1; block < numThreads; ++block) {
+		threads.push_back(std::thread(worker, block));
+	}
+	worker(0);
+	for (auto & thread : threads) {
+		thread.join();
+	}
+	m_solved = true;
+	return sweeps;
+}
+
+/// <summary>
+/// If the solver has been run since construction
+/// </summary>
+bool ValueIteration::solved() const
+{
+	return m_solved;
+}
+
+/// <summary>
+/// Build the per action reward and continuation planes from the environment
+/// </summary>
+/// <param name="env">The environment to solve</param>
+void ValueIteration::build(Environment & env)
+{
+	auto stateDim = env.getStateDim();
+	m_rows = stateDim.first;
+	m_cols = stateDim.second;
+	m_stride = m_cols + 2;
+	int numCells = m_rows * m_cols;
+	for (auto & values : m_values) {
+		values.assign((m_rows + 2) * m_stride, 0.f);
+	}
+	m_current = 0;
+	m_terminal.assign(numCells, 0);
+	for (int a = 0; a < s_numActions; ++a) {
+		m_reward[a].assign(numCells, s_disallowedReward);
+		m_continue[a].assign(numCells, 0.f);
+		m_offset[a] = env.actionCoords[a].first * m_stride + env.actionCoords[a].second;
+	}
+
+	for (int row = 0; row < m_rows; ++row) {
+		for (int col = 0; col < m_cols; ++col) {
+			int cell = row * m_cols + col;
+			int flags = env.m_tileFlags[row][col];
+			if (flags & (QLCTileGoal | QLCTileObstacle)) {
+				// Terminal and unreachable cells hold a value of 0
+				m_terminal[cell] = 1;
+				m_reward[4][cell] = 0;
+				continue;
+			}
+			for (int action : env.allowedActions(std::make_pair(row, col))) {
+				auto & dir = env.actionCoords[action];
+				int nextRow = row + dir.first;
+				int nextCol = col + dir.second;
+				// Mirrors the reward given by Environment::step
+				m_reward[action][cell] = env.R[row][col][action] - (std::abs(dir.first) + std::abs(dir.second));
+				bool done = env.m_tileFlags[nextRow][nextCol] & QLCTileGoal;
+				m_continue[action][cell] = done ? 0.f : m_gamma;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Run one Jacobi sweep over a block of rows writing into the next value grid
+/// </summary>
+/// <param name="begin">First row of the block</param>
+/// <param name="end">One past the last row of the block</param>
+/// <returns>The largest absolute value change in the block</returns>
+float ValueIteration::sweepRows(int begin, int end)
+{
+	const float * values = m_values[m_current].data();
+	float * nextValues = m_values[1 - m_current].data();
+	float delta = 0;
+	for (int row = begin; row < end; ++row) {
+		int cellRow = row * m_cols;
+		int paddedRow = paddedIndex(row, 0);
+		int col = 0;
+#if defined(QLC_AVX2) || defined(QLC_SSE)
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		__m128 deltas = _mm_setzero_ps();
+		for (; col + 4 <= m_cols; col += 4) {
+			int cell = cellRow + col;
+			int padded = paddedRow + col;
+			__m128 best = _mm_set1_ps(s_disallowedReward);
+			for (int a = 0; a < s_numActions; ++a) {
+				__m128 next = _mm_loadu_ps(values + padded + m_offset[a]);
+				__m128 q = _mm_add_ps(_mm_loadu_ps(&m_reward[a][cell]), _mm_mul_ps(_mm_loadu_ps(&m_continue[a][cell]), next));
+				best = _mm_max_ps(best, q);
+			}
+			__m128 change = _mm_and_ps(_mm_sub_ps(best, _mm_loadu_ps(values + padded)), absMask);
+			deltas = _mm_max_ps(deltas, change);
+			_mm_storeu_ps(nextValues + padded, best);
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, deltas);
+		delta = std::max(delta, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+#endif
+		for (; col < m_cols; ++col) {
+			int cell = cellRow + col;
+			int padded = paddedRow + col;
+			float best = s_disallowedReward;
+			for (int a = 0; a < s_numActions; ++a) {
+				best = std::max(best, m_reward[a][cell] + m_continue[a][cell] * values[padded + m_offset[a]]);
+			}
+			delta = std::max(delta, fabsf(best - values[padded]));
+			nextValues[padded] = best;
+		}
+	}
+	return delta;
+}
+
+/// <summary>
+/// Index of a cell in the padded value grid
+/// </summary>
+int ValueIteration::paddedIndex(int row, int col) const
+{
+	return (row + 1) * m_stride + col + 1;
+}
+
+/// <summary>
+/// Optimal value of a state
+/// </summary>
+float ValueIteration::value(int row, int col) const
+{
+	return m_values[m_current][paddedIndex(row, col)];
+}
+
+/// <summary>
+/// Optimal value of taking an action in a state and acting optimally after
+/// </summary>
+float ValueIteration::actionValue(int row, int col, int action) const
+{
+	int cell = row * m_cols + col;
+	return m_reward[action][cell] + m_continue[action][cell] * m_values[m_current][paddedIndex(row, col) + m_offset[action]];
+}
+
+/// <summary>
+/// If an action is allowed from a non terminal state
+/// </summary>
+bool ValueIteration::actionAllowed(int row, int col, int action) const
+{
+	return m_reward[action][row * m_cols + col] > s_disallowedReward;
+}
+
+/// <summary>
+/// The optimal action for a state
+/// </summary>
+int ValueIteration::greedyAction(int row, int col) const
+{
+	int best = s_numActions - 1;
+	for (int a = 0; a < s_numActions; ++a) {
+		if (actionValue(row, col, a) > actionValue(row, col, best))
+			best = a;
+	}
+	return best;
+}
+
+/// <summary>
+/// Warm start a Q table with the optimal action values.
+/// Disallowed actions take the lowest allowed value so they never become the max of a row.
+/// </summary>
+/// <param name="Q">The Q table to overwrite, must match the solved grid size</param>
+void ValueIteration::warmStart(QTable & Q) const
+{
+	for (int row = 0; row < m_rows; ++row) {
+		for (int col = 0; col < m_cols; ++col) {
+			if (m_terminal[row * m_cols + col]) {
+				for (int a = 0; a < s_numActions; ++a) {
+					Q.set(row, col, a, 0.f);
+				}
+				continue;
+			}
+			float lowest = value(row, col);
+			for (int a = 0; a < s_numActions; ++a) {
+				if (actionAllowed(row, col, a))
+					lowest = std::min(lowest, actionValue(row, col, a));
+			}
+			for (int a = 0; a < s_numActions; ++a) {
+				Q.set(row, col, a, actionAllowed(row, col, a) ? actionValue(row, col, a) : lowest);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Count the non terminal states where the greedy action of a learned Q table is not optimal
+/// </summary>
+/// <param name="Q">The learned Q table</param>
+/// <returns>The number of states with a sub optimal greedy action</returns>
+int ValueIteration::policyMismatches(const QTable & Q) const
+{
+	int mismatches = 0;
+	for (int row = 0; row < m_rows; ++row) {
+		for (int col = 0; col < m_cols; ++col) {
+			if (m_terminal[row * m_cols + col])
+				continue;
+			int learned = -1;
+			for (int a = 0; a < s_numActions; ++a) {
+				if (actionAllowed(row, col, a) && (learned < 0 || Q.get(row, col, a) > Q.get(row, col, learned)))
+					learned = a;
+			}
+			if (actionValue(row, col, learned) < value(row, col) - m_tolerance * 10)
+				mismatches++;
+		}
+	}
+	return mismatches;
+}
@@ -0,0 +1,57 @@
+#ifndef VALUEITERATION_H
+#define VALUEITERATION_H
+
+#include <vector>
+#include "Environment.h"
+#include "QTable.h"
+
+/// <summary>
+/// Exact value iteration solver over the environment grid, rewards and obstacles.
+/// Gives the optimal action values as a baseline for the learned Q tables and as an optimal scripted policy.
+/// Sweeps are Jacobi style so row blocks are solved in parallel, each row is evaluated with SIMD over the columns.
+/// Collisions between agents are not modelled.
+/// </summary>
+class ValueIteration {
+public:
+	ValueIteration();
+	~ValueIteration();
+
+	float m_gamma = 0.99f;			// Discount factor
+	float m_tolerance = 0.0001f;	// Largest value change allowed for convergence
+	int m_maxSweeps = 10000;
+	int m_numThreads = 0;			// Worker threads for row blocks, 0 uses the hardware concurrency
+
+	int solve(Environment & env);
+	bool solved() const;
+
+	float value(int row, int col) const;
+	float actionValue(int row, int col, int action) const;
+	bool actionAllowed(int row, int col, int action) const;
+	int greedyAction(int row, int col) const;
+
+	void warmStart(QTable & Q) const;
+	int policyMismatches(const QTable & Q) const;
+private:
+	static const int s_numActions = 5;
+
+	int m_rows = 0;
+	int m_cols = 0;
+	int m_stride = 0;	// Row stride of the padded value grid
+	bool m_solved = false;
+
+	// Value grids padded by one cell on every side so shifted row loads stay in bounds
+	std::vector<float> m_values[2];
+	int m_current = 0;
+
+	// Per action planes over the grid, disallowed actions have a very low reward and no continuation
+	std::vector<float> m_reward[s_numActions];
+	std::vector<float> m_continue[s_numActions];
+	int m_offset[s_numActions];
+	std::vector<unsigned char> m_terminal;
+
+	void build(Environment & env);
+	float sweepRows(int begin, int end);
+	int paddedIndex(int row, int col) const;
+};
+
+#endif //!VALUEITERATION_H
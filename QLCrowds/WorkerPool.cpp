@@ -0,0 +1,119 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+/// <summary>
+/// Default worker pool constructor, with no threads every job runs on the caller
+/// </summary>
+WorkerPool::WorkerPool() :
+	m_nextTask(0)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+/// <summary>
+/// Start the worker threads, replacing any already running
+/// </summary>
+/// <param name="numThreads">Threads besides the caller</param>
+void WorkerPool::start(int numThreads)
+{
+	stop();
+	m_stopping = false;
+	for (int i = 0; i < numThreads; ++i) {
+		// Workers take the current job number here, one taken once the thread runs could already be a job's
+		m_threads.push_back(std::thread(&WorkerPool::worker, this, m_job));
+	}
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto & thread : m_threads) {
+		thread.join();
+	}
+	m_threads.clear();
+}
+
+/// <summary>
+/// Threads a job is spread over, including the caller
+/// </summary>
+int WorkerPool::getThreads() const
+{
+	return (int)m_threads.size() + 1;
+}
+
+/// <summary>
+/// Run task(0) to task(tasks - 1) across the pool and the calling thread
+/// </summary>
+/// <param name="tasks">Number of tasks</param>
+/// <param name="task">Called once with each task index, from any thread</param>
+void WorkerPool::run(int tasks, const std::function<void(int)> & task)
+{
+	if (m_threads.empty() || tasks <= 1) {
+		for (int i = 0; i < tasks; ++i) {
+			task(i);
+		}
+		return;
+	}
+	// The caller takes a task itself, so a worker past tasks - 1 would find nothing left to take
+	int wake = std::min((int)m_threads.size(), tasks - 1);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_tasks = tasks;
+		m_nextTask = 0;
+		m_joining = wake;
+		m_job++;
+	}
+	for (int i = 0; i < wake; ++i) {
+		m_wake.notify_one();
+	}
+	work();
+	// Every task is taken, a worker that has not joined yet has nothing to do
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_joining = 0;
+	m_finished.wait(lock, [this] { return m_busy == 0; });
+	m_task = nullptr;
+}
+
+/// <summary>
+/// Worker thread, waits for a job that still wants workers, helps until its tasks are all taken then reports back
+/// </summary>
+void WorkerPool::worker(unsigned int lastJob)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, lastJob] { return m_stopping || m_job != lastJob; });
+			if (m_stopping)
+				return;
+			lastJob = m_job;
+			if (m_joining == 0)
+				continue;
+			m_joining--;
+			m_busy++;
+		}
+		work();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy == 0)
+			m_finished.notify_one();
+	}
+}
+
+/// <summary>
+/// Take and run tasks of the current job until none are left
+/// </summary>
+void WorkerPool::work()
+{
+	int task;
+	while ((task = m_nextTask.fetch_add(1)) < m_tasks) {
+		(*m_task)(task);
+	}
+}
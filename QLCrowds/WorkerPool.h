@@ -0,0 +1,48 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/// <summary>
+/// Persistent threads for splitting one job into independent tasks, so a job costs a wake up rather than
+/// creating threads. The calling thread works on the job too and run only returns once every task is done.
+/// Tasks are handed out in whatever order threads ask for them, anything order dependent must be combined by
+/// the caller afterwards. A job only wakes as many workers as it has tasks beyond the caller's first.
+/// One job runs at a time, run must not be called from inside a task.
+/// </summary>
+class WorkerPool {
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	void start(int numThreads);
+	void stop();
+	int getThreads() const;
+
+	void run(int tasks, const std::function<void(int)> & task);
+private:
+	WorkerPool(const WorkerPool &);
+	WorkerPool & operator=(const WorkerPool &);
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_finished;
+	const std::function<void(int)> * m_task = nullptr;
+	int m_tasks = 0;
+	std::atomic<int> m_nextTask;
+	int m_joining = 0;				// Worker threads the current job still wants, the rest go back to waiting
+	int m_busy = 0;					// Worker threads that joined the current job and have yet to finish it
+	unsigned int m_job = 0;			// Bumped for every job so a worker never runs one twice
+	bool m_stopping = false;
+
+	void worker(unsigned int lastJob);
+	void work();
+};
+
+#endif //!WORKERPOOL_H